@@ -1,5 +1,5 @@
 # Build types for various sanitizer modes
-set(CMAKE_CONFIGURATION_TYPES "ASAN;MSAN;USAN" CACHE STRING "" FORCE)
+set(CMAKE_CONFIGURATION_TYPES "ASAN;MSAN;USAN;TSAN" CACHE STRING "" FORCE)
 
 # General compile and link options
 set(COMPILE_OPTS -O3 -Wall -Wextra -Werror -pedantic -pedantic-errors)
@@ -27,6 +27,12 @@ if (CMAKE_BUILD_TYPE MATCHES USAN)
         -fsanitize=undefined,float-cast-overflow,float-divide-by-zero)
 endif()
 
+if (CMAKE_BUILD_TYPE MATCHES TSAN)
+    list(APPEND COMPILE_OPTS -O1 -fsanitize=thread -fno-omit-frame-pointer
+        -fno-sanitize-recover=all)
+    list(APPEND LINK_OPTS -fsanitize=thread)
+endif()
+
 # Configure clang-tidy
 if (${USE_CLANG_TIDY})
     set(CMAKE_CXX_CLANG_TIDY clang-tidy)
@@ -0,0 +1,148 @@
+#include "random_engines.h"
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <random>
+
+// Ways to map an engine output onto [0, n), the core of every sample() and
+// dequeue(). Sizes match the 70000 element blocks of lot_of_modifications.
+namespace {
+
+// Lemire, "Fast Random Integer Generation in an Interval" (2019): one
+// multiplication, the division is only needed on the rare rejection path
+template <class Rng>
+std::uint32_t bounded_lemire(Rng & rng, const std::uint32_t range)
+{
+    auto m = std::uint64_t{static_cast<std::uint32_t>(rng())} * range;
+    auto low = static_cast<std::uint32_t>(m);
+    if (low < range) {
+        const std::uint32_t threshold = (0u - range) % range;
+        while (low < threshold) {
+            m = std::uint64_t{static_cast<std::uint32_t>(rng())} * range;
+            low = static_cast<std::uint32_t>(m);
+        }
+    }
+    return static_cast<std::uint32_t>(m >> 32);
+}
+
+// Fills a small buffer of indices at once, so that the engine is stepped in
+// a tight loop and the consumer only reads from the buffer
+template <class Rng, std::size_t N = 64>
+class bounded_batch
+{
+public:
+    explicit bounded_batch(Rng & rng) : m_rng(rng) {}
+
+    std::uint32_t operator () (const std::uint32_t range)
+    {
+        if (m_pos == N || m_range != range) {
+            for (auto & x : m_buffer) {
+                x = bounded_lemire(m_rng, range);
+            }
+            m_pos = 0;
+            m_range = range;
+        }
+        return m_buffer[m_pos++];
+    }
+
+private:
+    Rng & m_rng;
+    std::array<std::uint32_t, N> m_buffer{};
+    std::size_t m_pos = N;
+    std::uint32_t m_range = 0;
+};
+
+template <class Rng>
+void BM_BoundedDistribution(benchmark::State & state)
+{
+    const auto range = static_cast<std::uint32_t>(state.range(0));
+    Rng rng(std::random_device{}());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(std::uniform_int_distribution<std::uint32_t>(0, range - 1)(rng));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Biased, only a lower bound for what a single division costs
+template <class Rng>
+void BM_BoundedModulo(benchmark::State & state)
+{
+    const auto range = static_cast<std::uint32_t>(state.range(0));
+    Rng rng(std::random_device{}());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(static_cast<std::uint32_t>(rng()) % range);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <class Rng>
+void BM_BoundedLemire(benchmark::State & state)
+{
+    const auto range = static_cast<std::uint32_t>(state.range(0));
+    Rng rng(std::random_device{}());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bounded_lemire(rng, range));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <class Rng>
+void BM_BoundedLemireBatch(benchmark::State & state)
+{
+    const auto range = static_cast<std::uint32_t>(state.range(0));
+    Rng rng(std::random_device{}());
+    bounded_batch<Rng> batch(rng);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(batch(range));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Shrinking range, as in a drain loop where every dequeue() sees size() - 1
+template <class Rng>
+void BM_DrainDistribution(benchmark::State & state)
+{
+    const auto n = static_cast<std::uint32_t>(state.range(0));
+    Rng rng(std::random_device{}());
+    for (auto _ : state) {
+        for (std::uint32_t size = n; size > 0; --size) {
+            benchmark::DoNotOptimize(std::uniform_int_distribution<std::uint32_t>(0, size - 1)(rng));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+template <class Rng>
+void BM_DrainLemire(benchmark::State & state)
+{
+    const auto n = static_cast<std::uint32_t>(state.range(0));
+    Rng rng(std::random_device{}());
+    for (auto _ : state) {
+        for (std::uint32_t size = n; size > 0; --size) {
+            benchmark::DoNotOptimize(bounded_lemire(rng, size));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+void ranges(benchmark::internal::Benchmark * b)
+{
+    b->Arg(70'000)->Arg(140'000)->Arg(210'000);
+}
+
+} // anonymous namespace
+
+BENCHMARK_TEMPLATE(BM_BoundedDistribution, std::mt19937_64)->Apply(ranges);
+BENCHMARK_TEMPLATE(BM_BoundedModulo, std::mt19937_64)->Apply(ranges);
+BENCHMARK_TEMPLATE(BM_BoundedLemire, std::mt19937_64)->Apply(ranges);
+BENCHMARK_TEMPLATE(BM_BoundedLemireBatch, std::mt19937_64)->Apply(ranges);
+
+BENCHMARK_TEMPLATE(BM_BoundedDistribution, random_engines::pcg32)->Apply(ranges);
+BENCHMARK_TEMPLATE(BM_BoundedModulo, random_engines::pcg32)->Apply(ranges);
+BENCHMARK_TEMPLATE(BM_BoundedLemire, random_engines::pcg32)->Apply(ranges);
+BENCHMARK_TEMPLATE(BM_BoundedLemireBatch, random_engines::pcg32)->Apply(ranges);
+
+BENCHMARK_TEMPLATE(BM_DrainDistribution, random_engines::xoshiro256pp)->Apply(ranges);
+BENCHMARK_TEMPLATE(BM_DrainLemire, random_engines::xoshiro256pp)->Apply(ranges);
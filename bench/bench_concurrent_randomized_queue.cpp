@@ -0,0 +1,66 @@
+#include "concurrent_randomized_queue.h"
+#include "randomized_queue.h"
+
+#include <benchmark/benchmark.h>
+
+#include <mutex>
+
+// Even threads produce, odd threads consume; the baseline wraps a plain
+// randomized_queue into a single mutex
+namespace {
+
+class locked_queue
+{
+    std::mutex m_mutex;
+    randomized_queue<int> m_queue;
+public:
+    void enqueue(const int x)
+    {
+        std::lock_guard lock(m_mutex);
+        m_queue.enqueue(x);
+    }
+
+    bool try_dequeue()
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_queue.empty()) {
+            return false;
+        }
+        benchmark::DoNotOptimize(m_queue.dequeue());
+        return true;
+    }
+};
+
+locked_queue g_locked;
+concurrent_randomized_queue<int> g_concurrent;
+
+void BM_LockedQueue(benchmark::State & state)
+{
+    for (auto _ : state) {
+        if (state.thread_index() % 2 == 0) {
+            g_locked.enqueue(state.thread_index());
+        }
+        else {
+            benchmark::DoNotOptimize(g_locked.try_dequeue());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ConcurrentQueue(benchmark::State & state)
+{
+    for (auto _ : state) {
+        if (state.thread_index() % 2 == 0) {
+            g_concurrent.enqueue(state.thread_index());
+        }
+        else {
+            benchmark::DoNotOptimize(g_concurrent.try_dequeue());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_LockedQueue)->ThreadRange(2, 32)->UseRealTime();
+BENCHMARK(BM_ConcurrentQueue)->ThreadRange(2, 32)->UseRealTime();
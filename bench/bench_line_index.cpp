@@ -0,0 +1,188 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LINE_INDEX_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define LINE_INDEX_NEON 1
+#endif
+
+// Ways to find line starts in an in-memory buffer, which is what subset()
+// spends its time on once the input is memory mapped
+namespace {
+
+using offsets_t = std::vector<std::size_t>;
+
+void index_scalar(const char * data, const std::size_t size, offsets_t & offsets)
+{
+    for (std::size_t i = 0; i < size; ++i) {
+        if (data[i] == '\n') {
+            offsets.push_back(i + 1);
+        }
+    }
+}
+
+void index_memchr(const char * data, const std::size_t size, offsets_t & offsets)
+{
+    const char * p = data;
+    const char * const end = data + size;
+    while ((p = static_cast<const char *>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)))) != nullptr) {
+        ++p;
+        offsets.push_back(static_cast<std::size_t>(p - data));
+    }
+}
+
+// Appends the positions of set bits of a block mask
+void push_mask(std::uint64_t mask, const std::size_t base, offsets_t & offsets)
+{
+    while (mask != 0) {
+        offsets.push_back(base + static_cast<std::size_t>(__builtin_ctzll(mask)) + 1);
+        mask &= mask - 1;
+    }
+}
+
+#if defined(LINE_INDEX_X86)
+
+void index_sse2(const char * data, const std::size_t size, offsets_t & offsets)
+{
+    const auto newline = _mm_set1_epi8('\n');
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+        push_mask(mask, i, offsets);
+    }
+    const auto tail_begin = offsets.size();
+    index_scalar(data + i, size - i, offsets);
+    for (auto j = tail_begin; j < offsets.size(); ++j) {
+        offsets[j] += i;
+    }
+}
+
+__attribute__((target("avx2")))
+void index_avx2(const char * data, const std::size_t size, offsets_t & offsets)
+{
+    const auto newline = _mm256_set1_epi8('\n');
+    std::size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        const auto lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const auto hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 32));
+        const auto mask_lo = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline)));
+        const auto mask_hi = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)));
+        push_mask((std::uint64_t{mask_hi} << 32) | mask_lo, i, offsets);
+    }
+    const auto tail_begin = offsets.size();
+    index_scalar(data + i, size - i, offsets);
+    for (auto j = tail_begin; j < offsets.size(); ++j) {
+        offsets[j] += i;
+    }
+}
+
+#elif defined(LINE_INDEX_NEON)
+
+void index_neon(const char * data, const std::size_t size, offsets_t & offsets)
+{
+    const auto newline = vdupq_n_u8('\n');
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const auto block = vld1q_u8(reinterpret_cast<const std::uint8_t *>(data + i));
+        const auto eq = vceqq_u8(block, newline);
+        // Narrow 16 bytes of 0x00/0xff into a 64 bit mask of nibbles
+        const auto nibbles = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        std::uint64_t mask = nibbles & 0x8888888888888888ULL;
+        while (mask != 0) {
+            offsets.push_back(i + static_cast<std::size_t>(__builtin_ctzll(mask)) / 4 + 1);
+            mask &= mask - 1;
+        }
+    }
+    const auto tail_begin = offsets.size();
+    index_scalar(data + i, size - i, offsets);
+    for (auto j = tail_begin; j < offsets.size(); ++j) {
+        offsets[j] += i;
+    }
+}
+
+#endif
+
+using index_fn = void (*)(const char *, std::size_t, offsets_t &);
+
+// Runtime dispatch, as a binary built for the baseline ISA would do
+index_fn best_index()
+{
+#if defined(LINE_INDEX_X86)
+    if (__builtin_cpu_supports("avx2")) {
+        return &index_avx2;
+    }
+    return &index_sse2;
+#elif defined(LINE_INDEX_NEON)
+    return &index_neon;
+#else
+    return &index_memchr;
+#endif
+}
+
+// Text shaped like the subset() test inputs: short words on separate lines
+const std::string & text(const std::size_t size)
+{
+    static std::string cache;
+    if (cache.size() != size) {
+        static const char * const words[] = {"One", "Two", "Three", "Hello, world", "Bonjour monde", "Hallo wereld"};
+        std::mt19937 rng(42);
+        cache.clear();
+        cache.reserve(size);
+        while (cache.size() < size) {
+            cache += words[rng() % std::size(words)];
+            cache += '\n';
+        }
+        cache.resize(size);
+    }
+    return cache;
+}
+
+void BM_LineIndex(benchmark::State & state, const index_fn index)
+{
+    const auto & input = text(static_cast<std::size_t>(state.range(0)) << 20);
+    offsets_t offsets, expected;
+    index_memchr(input.data(), input.size(), expected);
+    index(input.data(), input.size(), offsets);
+    if (offsets != expected) {
+        state.SkipWithError("line offsets differ from memchr");
+        return;
+    }
+    for (auto _ : state) {
+        offsets.clear();
+        index(input.data(), input.size(), offsets);
+        benchmark::DoNotOptimize(offsets.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(input.size()));
+    state.counters["lines"] = static_cast<double>(offsets.size());
+}
+
+// Picks the implementation when the benchmark runs, not during static
+// initialization before main()
+void BM_LineIndexDispatched(benchmark::State & state)
+{
+    BM_LineIndex(state, best_index());
+}
+
+void sizes(benchmark::internal::Benchmark * b)
+{
+    // Megabytes
+    b->Arg(16)->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+}
+
+} // anonymous namespace
+
+BENCHMARK_CAPTURE(BM_LineIndex, scalar, &index_scalar)->Apply(sizes);
+BENCHMARK_CAPTURE(BM_LineIndex, memchr, &index_memchr)->Apply(sizes);
+#if defined(LINE_INDEX_X86)
+BENCHMARK_CAPTURE(BM_LineIndex, sse2, &index_sse2)->Apply(sizes);
+#endif
+BENCHMARK(BM_LineIndexDispatched)->Apply(sizes);
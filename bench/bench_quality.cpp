@@ -0,0 +1,165 @@
+#include "chi_square.h"
+#include "random_engines.h"
+#include "randomized_queue.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Distribution quality next to speed. The counters are meant for
+// --benchmark_format=json: CI compares "uniform" (1 or 0) besides ns/op,
+// so a faster engine or order that skews the distribution fails the run.
+
+namespace {
+
+// Elements per queue, small enough for every bin to collect many hits
+constexpr std::size_t quality_size = 16;
+
+template <class Rng>
+void fill(randomized_queue<int, Rng> & queue, const std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        queue.enqueue(static_cast<int>(i));
+    }
+}
+
+void report_uniformity(benchmark::State & state, const std::vector<std::size_t> & counts, const std::size_t dof)
+{
+    if (counts.empty() || state.iterations() == 0) {
+        return;
+    }
+    std::size_t total = 0;
+    for (const auto c : counts) {
+        total += c;
+    }
+    const double expected = static_cast<double>(total) / static_cast<double>(counts.size());
+    const double statistic = chi_square::statistic(counts, expected);
+    const double limit = chi_square::limit(dof);
+    state.counters["chi_square"] = statistic;
+    state.counters["limit"] = limit;
+    state.counters["uniform"] = statistic < limit;
+}
+
+// Chi-square over the sampled element
+template <class Rng>
+void BM_QualitySample(benchmark::State & state)
+{
+    randomized_queue<int, Rng> queue;
+    fill(queue, quality_size);
+    std::vector<std::size_t> counts(quality_size);
+    for (auto _ : state) {
+        ++counts[static_cast<std::size_t>(queue.sample())];
+    }
+    state.SetItemsProcessed(state.iterations());
+    report_uniformity(state, counts, quality_size - 1);
+}
+
+// Chi-square over the element dequeued first and last from a fresh queue
+template <class Rng>
+void BM_QualityDequeue(benchmark::State & state)
+{
+    std::vector<std::size_t> first(quality_size), last(quality_size);
+    randomized_queue<int, Rng> queue;
+    for (auto _ : state) {
+        fill(queue, quality_size);
+        ++first[static_cast<std::size_t>(queue.dequeue())];
+        while (queue.size() > 1) {
+            benchmark::DoNotOptimize(queue.dequeue());
+        }
+        ++last[static_cast<std::size_t>(queue.dequeue())];
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(quality_size));
+    first.insert(first.end(), last.begin(), last.end());
+    report_uniformity(state, first, 2 * (quality_size - 1));
+}
+
+// Chi-square over (element bin, position bin) cells of iteration orders.
+// The queue spans many blocks of the blocked() order, so bias between
+// blocks shows up and not just the shuffle inside one block. Every
+// iteration reads one random position of a fresh order, which keeps the
+// counted cells independent of each other.
+template <bool Blocked>
+void BM_QualityPosition(benchmark::State & state)
+{
+    constexpr std::size_t blocks = 64, bins = 16;
+    const std::size_t n = blocks * randomized_queue<int>::block_size();
+    randomized_queue<int> queue;
+    fill(queue, n);
+    std::mt19937_64 rng(std::random_device{}());
+    std::uniform_int_distribution<std::size_t> position(0, n - 1);
+    std::vector<std::size_t> counts(bins * bins);
+    for (auto _ : state) {
+        const std::size_t pos = position(rng);
+        std::size_t x = 0;
+        if constexpr (Blocked) {
+            x = static_cast<std::size_t>(queue.blocked().begin()[static_cast<std::ptrdiff_t>(pos)]);
+        }
+        else {
+            x = static_cast<std::size_t>(queue.begin()[static_cast<std::ptrdiff_t>(pos)]);
+        }
+        ++counts[x * bins / n * bins + pos * bins / n];
+    }
+    state.SetItemsProcessed(state.iterations());
+    report_uniformity(state, counts, (bins - 1) * (bins - 1));
+}
+
+// Spearman correlation between the positions of elements in successive
+// begin() orders. Independent orders give r around zero with variance
+// 1 / (n - 1), the mean over m pairs is reported as a z-score.
+void BM_QualitySerial(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    randomized_queue<int> queue;
+    fill(queue, n);
+    std::vector<double> previous(n), current(n);
+    double sum = 0;
+    std::size_t pairs = 0;
+    bool first = true;
+    for (auto _ : state) {
+        std::size_t pos = 0;
+        for (const int x : queue) {
+            current[static_cast<std::size_t>(x)] = static_cast<double>(pos++);
+        }
+        if (!first) {
+            double d2 = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                const double d = current[i] - previous[i];
+                d2 += d * d;
+            }
+            const double nn = static_cast<double>(n);
+            sum += 1 - 6 * d2 / (nn * (nn * nn - 1));
+            ++pairs;
+        }
+        first = false;
+        previous.swap(current);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+    if (pairs != 0) {
+        const double z = sum / static_cast<double>(pairs) * std::sqrt(static_cast<double>(pairs) * static_cast<double>(n - 1));
+        state.counters["z"] = z;
+        state.counters["uniform"] = std::abs(z) < 5;
+    }
+}
+
+} // anonymous namespace
+
+BENCHMARK_TEMPLATE(BM_QualitySample, std::mt19937);
+BENCHMARK_TEMPLATE(BM_QualitySample, std::minstd_rand);
+BENCHMARK_TEMPLATE(BM_QualitySample, random_engines::xoshiro256pp);
+BENCHMARK_TEMPLATE(BM_QualitySample, random_engines::pcg32);
+BENCHMARK_TEMPLATE(BM_QualitySample, random_engines::counter_engine);
+
+BENCHMARK_TEMPLATE(BM_QualityDequeue, std::mt19937);
+BENCHMARK_TEMPLATE(BM_QualityDequeue, std::minstd_rand);
+BENCHMARK_TEMPLATE(BM_QualityDequeue, random_engines::xoshiro256pp);
+BENCHMARK_TEMPLATE(BM_QualityDequeue, random_engines::pcg32);
+BENCHMARK_TEMPLATE(BM_QualityDequeue, random_engines::counter_engine);
+
+BENCHMARK_TEMPLATE(BM_QualityPosition, false);
+BENCHMARK_TEMPLATE(BM_QualityPosition, true);
+
+BENCHMARK(BM_QualitySerial)->Arg(16)->Arg(1'000);
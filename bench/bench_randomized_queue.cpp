@@ -0,0 +1,451 @@
+#include "allocation_counter.h"
+#include "non_copyable.h"
+#include "random_engines.h"
+#include "randomized_queue.h"
+#include "small_randomized_queue.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using test_types::NonCopyable;
+
+// Trivially copyable, constructible from int for converting ranges
+struct Trivial
+{
+    Trivial() = default;
+    Trivial(const int x) : id(x), value(x), tag(static_cast<std::uint32_t>(x)) {}
+
+    std::int64_t id = 0;
+    double value = 0;
+    std::uint32_t tag = 0;
+};
+
+template <class T>
+T create(const int x)
+{
+    return x;
+}
+
+template <>
+std::string create<std::string>(const int x)
+{
+    return std::to_string(x);
+}
+
+template <class T, class... Params>
+void fill(randomized_queue<T, Params...> & queue, const std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        queue.enqueue(create<T>(static_cast<int>(i)));
+    }
+}
+
+// Reports time per single queue operation and heap usage per iteration
+void report(benchmark::State & state, const std::size_t ops_per_iteration, const allocation_counter::snapshot & allocated)
+{
+    const auto ops = static_cast<std::int64_t>(ops_per_iteration);
+    state.SetItemsProcessed(state.iterations() * ops);
+    state.counters["time/op"] = benchmark::Counter(static_cast<double>(ops),
+            benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocated.count), benchmark::Counter::kAvgIterations);
+    state.counters["bytes"] = benchmark::Counter(static_cast<double>(allocated.bytes), benchmark::Counter::kAvgIterations);
+}
+
+template <class T>
+void BM_Enqueue(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    allocation_counter::snapshot allocated;
+    for (auto _ : state) {
+        const auto before = allocation_counter::current();
+        {
+            randomized_queue<T> queue;
+            fill(queue, n);
+            benchmark::DoNotOptimize(queue);
+        }
+        allocated = allocated + (allocation_counter::current() - before);
+    }
+    report(state, n, allocated);
+}
+
+template <class T>
+void BM_Dequeue(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    allocation_counter::snapshot allocated;
+    for (auto _ : state) {
+        state.PauseTiming();
+        randomized_queue<T> queue;
+        fill(queue, n);
+        const auto before = allocation_counter::current();
+        state.ResumeTiming();
+
+        while (!queue.empty()) {
+            benchmark::DoNotOptimize(queue.dequeue());
+        }
+
+        state.PauseTiming();
+        allocated = allocated + (allocation_counter::current() - before);
+        state.ResumeTiming();
+    }
+    report(state, n, allocated);
+}
+
+// Bulk copy from lvalues. A same-typed range of a trivially copyable T
+// takes the bulk path, a converting range of the same size constructs
+// element by element, the difference is the gain of the fast path
+template <class T, class Source>
+void BM_EnqueueRangeCopy(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    std::vector<Source> values;
+    values.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        values.emplace_back(create<Source>(static_cast<int>(i)));
+    }
+    allocation_counter::snapshot allocated;
+    for (auto _ : state) {
+        const auto before = allocation_counter::current();
+        {
+            randomized_queue<T> queue;
+            queue.enqueue_range(values.begin(), values.end());
+            benchmark::DoNotOptimize(queue);
+        }
+        state.PauseTiming();
+        allocated = allocated + (allocation_counter::current() - before);
+        state.ResumeTiming();
+    }
+    report(state, n, allocated);
+}
+
+template <class T>
+void BM_EnqueueRange(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    allocation_counter::snapshot allocated;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<T> values;
+        values.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            values.emplace_back(create<T>(static_cast<int>(i)));
+        }
+        const auto before = allocation_counter::current();
+        state.ResumeTiming();
+        {
+            randomized_queue<T> queue;
+            queue.enqueue_range(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+            benchmark::DoNotOptimize(queue);
+        }
+        state.PauseTiming();
+        allocated = allocated + (allocation_counter::current() - before);
+        state.ResumeTiming();
+    }
+    report(state, n, allocated);
+}
+
+template <class T>
+void BM_DequeueN(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    allocation_counter::snapshot allocated;
+    std::vector<T> out;
+    out.reserve(n);
+    for (auto _ : state) {
+        state.PauseTiming();
+        randomized_queue<T> queue;
+        fill(queue, n);
+        out.clear();
+        const auto before = allocation_counter::current();
+        state.ResumeTiming();
+
+        queue.dequeue_n(n, std::back_inserter(out));
+        benchmark::DoNotOptimize(out.data());
+
+        state.PauseTiming();
+        allocated = allocated + (allocation_counter::current() - before);
+        state.ResumeTiming();
+    }
+    report(state, n, allocated);
+}
+
+template <class T>
+void BM_DequeueAll(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    allocation_counter::snapshot allocated;
+    std::vector<T> out;
+    out.reserve(n);
+    for (auto _ : state) {
+        state.PauseTiming();
+        randomized_queue<T> queue;
+        fill(queue, n);
+        out.clear();
+        const auto before = allocation_counter::current();
+        state.ResumeTiming();
+
+        queue.dequeue_all(std::back_inserter(out));
+        benchmark::DoNotOptimize(out.data());
+
+        state.PauseTiming();
+        allocated = allocated + (allocation_counter::current() - before);
+        state.ResumeTiming();
+    }
+    report(state, n, allocated);
+}
+
+template <class T>
+void BM_Sample(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    randomized_queue<T> queue;
+    fill(queue, n);
+    const auto before = allocation_counter::current();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(queue.sample());
+    }
+    report(state, 1, allocation_counter::current() - before);
+}
+
+template <class T>
+void BM_Iterate(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    randomized_queue<T> queue;
+    fill(queue, n);
+    const auto before = allocation_counter::current();
+    for (auto _ : state) {
+        for (const auto & x : queue) {
+            benchmark::DoNotOptimize(x);
+        }
+    }
+    report(state, n, allocation_counter::current() - before);
+}
+
+template <class Rng>
+void BM_SampleEngine(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    randomized_queue<int, Rng> queue;
+    fill(queue, n);
+    const auto before = allocation_counter::current();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(queue.sample());
+    }
+    report(state, 1, allocation_counter::current() - before);
+    state.counters["queue_size"] = static_cast<double>(sizeof(queue));
+}
+
+template <class Rng>
+void BM_DequeueEngine(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        randomized_queue<int, Rng> queue;
+        fill(queue, n);
+        state.ResumeTiming();
+        while (!queue.empty()) {
+            benchmark::DoNotOptimize(queue.dequeue());
+        }
+    }
+    report(state, n, {});
+}
+
+// k distinct elements out of a queue of range(0) elements
+void BM_SampleN(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    const auto k = static_cast<std::size_t>(state.range(1));
+    randomized_queue<std::string> queue;
+    fill(queue, n);
+    std::vector<std::reference_wrapper<const std::string>> out;
+    out.reserve(k);
+    for (auto _ : state) {
+        out.clear();
+        queue.sample_n(k, std::back_inserter(out));
+        benchmark::DoNotOptimize(out.data());
+    }
+    report(state, 1, {});
+}
+
+// The same with what was available before sample_n: dequeue k and put them back
+void BM_SampleNByDequeue(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    const auto k = static_cast<std::size_t>(state.range(1));
+    randomized_queue<std::string> queue;
+    fill(queue, n);
+    std::vector<std::string> out;
+    out.reserve(k);
+    for (auto _ : state) {
+        out.clear();
+        for (std::size_t i = 0; i < k; ++i) {
+            out.push_back(queue.dequeue());
+        }
+        benchmark::DoNotOptimize(out.data());
+        for (auto & s : out) {
+            queue.enqueue(std::move(s));
+        }
+    }
+    report(state, 1, {});
+}
+
+// Lifetime of a per-session queue: create, fill with a few elements, drain
+template <class Queue>
+void BM_SmallSession(benchmark::State & state)
+{
+    const auto n = static_cast<int>(state.range(0));
+    const auto before = allocation_counter::current();
+    for (auto _ : state) {
+        Queue queue;
+        for (int i = 0; i < n; ++i) {
+            queue.enqueue(i);
+        }
+        while (!queue.empty()) {
+            benchmark::DoNotOptimize(queue.dequeue());
+        }
+    }
+    report(state, 1, allocation_counter::current() - before);
+    state.counters["queue_size"] = static_cast<double>(sizeof(Queue));
+}
+
+// One queue shared by all threads through a const reference
+const randomized_queue<int> & shared_queue()
+{
+    static randomized_queue<int> queue;
+    static const bool filled = (fill(queue, 1'000'000), true);
+    static_cast<void>(filled);
+    return queue;
+}
+
+void BM_SharedSample(benchmark::State & state)
+{
+    const auto & queue = shared_queue();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(queue.sample());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_SharedBegin(benchmark::State & state)
+{
+    const auto & queue = shared_queue();
+    for (auto _ : state) {
+        auto it = queue.begin();
+        benchmark::DoNotOptimize(*it);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <class T>
+void BM_IterateBlocked(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    randomized_queue<T> queue;
+    fill(queue, n);
+    const auto before = allocation_counter::current();
+    for (auto _ : state) {
+        for (const auto & x : queue.blocked()) {
+            benchmark::DoNotOptimize(x);
+        }
+    }
+    report(state, n, allocation_counter::current() - before);
+}
+
+// Scan which stops after a few elements, the cost is dominated by begin()
+template <class T>
+void BM_IterateFirst(benchmark::State & state)
+{
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const std::size_t prefix = 16;
+    randomized_queue<T> queue;
+    fill(queue, n);
+    const auto before = allocation_counter::current();
+    for (auto _ : state) {
+        auto it = queue.begin();
+        for (std::size_t i = 0; i < prefix && i < n; ++i, ++it) {
+            benchmark::DoNotOptimize(*it);
+        }
+    }
+    report(state, 1, allocation_counter::current() - before);
+}
+
+void sizes(benchmark::internal::Benchmark * b)
+{
+    b->RangeMultiplier(10)->Range(1'000, 100'000'000);
+}
+
+} // anonymous namespace
+
+BENCHMARK_TEMPLATE(BM_Enqueue, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Enqueue, std::string)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Enqueue, NonCopyable)->Apply(sizes);
+
+BENCHMARK_TEMPLATE(BM_Dequeue, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Dequeue, std::string)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Dequeue, NonCopyable)->Apply(sizes);
+
+BENCHMARK_TEMPLATE(BM_EnqueueRange, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_EnqueueRange, std::string)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_EnqueueRange, NonCopyable)->Apply(sizes);
+
+BENCHMARK_TEMPLATE(BM_EnqueueRangeCopy, int, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_EnqueueRangeCopy, int, short)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_EnqueueRangeCopy, Trivial, Trivial)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_EnqueueRangeCopy, Trivial, int)->Apply(sizes);
+
+BENCHMARK_TEMPLATE(BM_DequeueN, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_DequeueN, std::string)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_DequeueN, NonCopyable)->Apply(sizes);
+
+BENCHMARK_TEMPLATE(BM_DequeueAll, int)->Apply(sizes)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_DequeueAll, std::string)->Apply(sizes)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_DequeueAll, NonCopyable)->Apply(sizes)->UseRealTime();
+
+BENCHMARK_TEMPLATE(BM_Sample, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Sample, std::string)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Sample, NonCopyable)->Apply(sizes);
+
+BENCHMARK_TEMPLATE(BM_Iterate, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Iterate, std::string)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_Iterate, NonCopyable)->Apply(sizes);
+
+BENCHMARK_TEMPLATE(BM_IterateBlocked, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_IterateBlocked, std::string)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_IterateBlocked, NonCopyable)->Apply(sizes);
+
+BENCHMARK_TEMPLATE(BM_IterateFirst, int)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_IterateFirst, std::string)->Apply(sizes);
+
+BENCHMARK_TEMPLATE(BM_SampleEngine, std::mt19937)->Arg(70'000);
+BENCHMARK_TEMPLATE(BM_SampleEngine, std::mt19937_64)->Arg(70'000);
+BENCHMARK_TEMPLATE(BM_SampleEngine, random_engines::xoshiro256pp)->Arg(70'000);
+BENCHMARK_TEMPLATE(BM_SampleEngine, random_engines::pcg32)->Arg(70'000);
+BENCHMARK_TEMPLATE(BM_SampleEngine, random_engines::counter_engine)->Arg(70'000);
+
+BENCHMARK_TEMPLATE(BM_DequeueEngine, std::mt19937)->Arg(70'000);
+BENCHMARK_TEMPLATE(BM_DequeueEngine, std::mt19937_64)->Arg(70'000);
+BENCHMARK_TEMPLATE(BM_DequeueEngine, random_engines::xoshiro256pp)->Arg(70'000);
+BENCHMARK_TEMPLATE(BM_DequeueEngine, random_engines::pcg32)->Arg(70'000);
+BENCHMARK_TEMPLATE(BM_DequeueEngine, random_engines::counter_engine)->Arg(70'000);
+
+BENCHMARK(BM_SampleN)->ArgsProduct({{70'000}, {1, 16, 1'000, 60'000}});
+BENCHMARK(BM_SampleNByDequeue)->ArgsProduct({{70'000}, {1, 16, 1'000, 60'000}});
+
+BENCHMARK_TEMPLATE(BM_SmallSession, randomized_queue<int>)->DenseRange(1, 8);
+BENCHMARK_TEMPLATE(BM_SmallSession, randomized_queue<int, random_engines::xoshiro256pp>)->DenseRange(1, 8);
+BENCHMARK_TEMPLATE(BM_SmallSession, small_randomized_queue<int, 8>)->DenseRange(1, 8);
+
+BENCHMARK(BM_SharedSample)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_SharedBegin)->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,60 @@
+#include "randomized_queue.h"
+#include "randomized_queue_soa.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+namespace {
+
+struct Order
+{
+    std::int64_t id;
+    double price;
+    double quantity;
+    std::int64_t timestamp;
+};
+
+void BM_ScanOneFieldAos(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    randomized_queue<Order> queue;
+    for (std::size_t i = 0; i < n; ++i) {
+        queue.enqueue(Order{static_cast<std::int64_t>(i), 1.0, 2.0, 0});
+    }
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto & order : queue) {
+            sum += order.price;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+
+void BM_ScanOneFieldSoa(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    randomized_queue_soa<std::int64_t, double, double, std::int64_t> queue;
+    for (std::size_t i = 0; i < n; ++i) {
+        queue.enqueue(static_cast<std::int64_t>(i), 1.0, 2.0, 0);
+    }
+    for (auto _ : state) {
+        double sum = 0;
+        for (const double price : queue.column<1>()) {
+            sum += price;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+
+void sizes(benchmark::internal::Benchmark * b)
+{
+    b->RangeMultiplier(10)->Range(1'000, 10'000'000);
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_ScanOneFieldAos)->Apply(sizes);
+BENCHMARK(BM_ScanOneFieldSoa)->Apply(sizes);
@@ -0,0 +1,124 @@
+#include "subset.h"
+#include "temp_file.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// subset() over inputs shaped like src/test_subset.cpp, scaled up to gigabytes
+namespace {
+
+// Generated once per size and kept until the benchmark binary exits
+class input_file
+{
+    std::filesystem::path m_path;
+public:
+    explicit input_file(const std::size_t megabytes)
+        : m_path(std::filesystem::temp_directory_path() / ("subset_bench_" + std::to_string(megabytes) + "M_" + std::to_string(std::random_device{}())))
+    {
+        static const char * const words[] = {"One", "Two", "Three", "Hello, world", "Bonjour monde", "Hallo wereld"};
+        std::mt19937 rng(42);
+        std::ofstream out(m_path, std::ios::binary);
+        const std::size_t size = megabytes << 20;
+        std::size_t written = 0;
+        std::size_t line = 0;
+        while (written < size) {
+            const std::string s = std::string(words[rng() % std::size(words)]) + ' ' + std::to_string(line++) + '\n';
+            out << s;
+            written += s.size();
+        }
+    }
+    input_file(const input_file &) = delete;
+    input_file & operator = (const input_file &) = delete;
+    ~input_file()
+    {
+        std::error_code ec;
+        std::filesystem::remove(m_path, ec);
+    }
+
+    const std::filesystem::path & path() const { return m_path; }
+};
+
+const input_file & input(const std::size_t megabytes)
+{
+    static std::map<std::size_t, std::unique_ptr<input_file>> files;
+    auto & file = files[megabytes];
+    if (!file) {
+        file = std::make_unique<input_file>(megabytes);
+    }
+    return *file;
+}
+
+const unsigned long k = 1000;
+
+void report(benchmark::State & state)
+{
+    state.SetBytesProcessed(state.iterations() * (state.range(0) << 20));
+}
+
+void BM_SubsetStream(benchmark::State & state)
+{
+    const auto & file = input(static_cast<std::size_t>(state.range(0)));
+    std::ofstream out("/dev/null");
+    for (auto _ : state) {
+        std::ifstream in(file.path(), std::ios::binary);
+        subset(k, in, out);
+    }
+    report(state);
+}
+
+void BM_SubsetFile(benchmark::State & state)
+{
+    const auto & file = input(static_cast<std::size_t>(state.range(0)));
+    const unique_file out(std::fopen("/dev/null", "w"));
+    if (!out) {
+        state.SkipWithError("cannot open /dev/null");
+        return;
+    }
+    for (auto _ : state) {
+        subset(k, file.path(), out.get());
+    }
+    report(state);
+}
+
+// Shards of 64 MiB each, as rotated logs would be
+void BM_SubsetShards(benchmark::State & state)
+{
+    const auto threads = static_cast<unsigned>(state.range(0));
+    static std::vector<std::unique_ptr<input_file>> files;
+    std::vector<std::filesystem::path> paths;
+    for (std::size_t i = 0; i < 16; ++i) {
+        if (files.size() <= i) {
+            files.push_back(std::make_unique<input_file>(64));
+        }
+        paths.push_back(files[i]->path());
+    }
+    const unique_file out(std::fopen("/dev/null", "w"));
+    if (!out) {
+        state.SkipWithError("cannot open /dev/null");
+        return;
+    }
+    for (auto _ : state) {
+        subset(k, paths, out.get(), threads);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(paths.size() << 26));
+}
+
+void sizes(benchmark::internal::Benchmark * b)
+{
+    // Megabytes
+    b->Arg(16)->Arg(256)->Arg(1024)->Arg(4096)->Unit(benchmark::kMillisecond);
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_SubsetStream)->Apply(sizes);
+BENCHMARK(BM_SubsetFile)->Apply(sizes);
+BENCHMARK(BM_SubsetShards)->RangeMultiplier(2)->Range(1, 64)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,61 @@
+#include "weighted_randomized_queue.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+namespace {
+
+void fill(weighted_randomized_queue<int> & queue, const std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        queue.enqueue(static_cast<int>(i), 1.0 + static_cast<double>(i % 100));
+    }
+}
+
+void BM_WeightedSample(benchmark::State & state)
+{
+    weighted_randomized_queue<int> queue;
+    fill(queue, static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(queue.sample());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_WeightedSampleFrozen(benchmark::State & state)
+{
+    weighted_randomized_queue<int> queue;
+    fill(queue, static_cast<std::size_t>(state.range(0)));
+    queue.freeze();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(queue.sample());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_WeightedDequeue(benchmark::State & state)
+{
+    const auto n = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        weighted_randomized_queue<int> queue;
+        fill(queue, n);
+        state.ResumeTiming();
+        while (!queue.empty()) {
+            benchmark::DoNotOptimize(queue.dequeue());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+
+void sizes(benchmark::internal::Benchmark * b)
+{
+    b->RangeMultiplier(10)->Range(1'000, 10'000'000);
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_WeightedSample)->Apply(sizes);
+BENCHMARK(BM_WeightedSampleFrozen)->Apply(sizes);
+BENCHMARK(BM_WeightedDequeue)->Apply(sizes);
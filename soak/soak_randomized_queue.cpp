@@ -0,0 +1,284 @@
+#include "concurrent_randomized_queue.h"
+#include "randomized_queue.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+// Long running mixed workload over shared queues. Mutating operations go to a
+// concurrent_randomized_queue, sample and iterate run as concurrent const
+// operations on a randomized_queue. Usage:
+//
+//   runSoak [--seconds N] [--elements N] [--threads N] [--iterate-length N]
+//           [--mix enqueue,dequeue,sample,iterate]
+//
+// The mix gives the relative weight of each operation. Operations run in
+// batches of one kind, a batch is timed as a whole and its mean goes into the
+// latency histogram, so clock reads do not dominate fast operations. The
+// operations done in every 100 ms interval give the throughput percentiles.
+
+namespace {
+
+enum operation : std::size_t { op_enqueue, op_dequeue, op_sample, op_iterate, op_count };
+constexpr const char * operation_names[op_count] = {"enqueue", "dequeue", "sample", "iterate"};
+
+struct options
+{
+    std::uint64_t seconds = 60;
+    std::size_t elements = 10'000'000;
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t iterate_length = 1000;
+    std::array<unsigned, op_count> mix = {30, 30, 30, 10};
+};
+
+constexpr std::size_t batch_size = 64;
+constexpr auto interval = std::chrono::milliseconds(100);
+
+// Operations per interval, one row per interval
+using throughput_log = std::vector<std::array<std::uint64_t, op_count>>;
+
+// Log-linear latency histogram in nanoseconds: 16 linear sub-buckets per power of two
+class latency_histogram
+{
+    static constexpr std::size_t sub_buckets = 16;
+    static constexpr std::size_t bucket_count = 64 * sub_buckets;
+
+public:
+    void record(const std::uint64_t ns)
+    {
+        ++m_counts[bucket(ns)];
+        ++m_total;
+        m_max = std::max(m_max, ns);
+    }
+
+    void merge(const latency_histogram & other)
+    {
+        for (std::size_t i = 0; i < bucket_count; ++i) {
+            m_counts[i] += other.m_counts[i];
+        }
+        m_total += other.m_total;
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    std::uint64_t total() const { return m_total; }
+    std::uint64_t max() const { return m_max; }
+
+    // Upper bound of the bucket holding the q-quantile
+    std::uint64_t percentile(const double q) const
+    {
+        const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(m_total));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < bucket_count; ++i) {
+            seen += m_counts[i];
+            if (seen > rank) {
+                return std::min(upper_bound(i), m_max);
+            }
+        }
+        return m_max;
+    }
+
+private:
+    static std::size_t bucket(const std::uint64_t ns)
+    {
+        if (ns < sub_buckets) {
+            return static_cast<std::size_t>(ns);
+        }
+        std::size_t log = 0;
+        while ((ns >> log) >= 2 * sub_buckets) {
+            ++log;
+        }
+        return (log + 1) * sub_buckets + static_cast<std::size_t>((ns >> log) - sub_buckets);
+    }
+
+    static std::uint64_t upper_bound(const std::size_t i)
+    {
+        if (i < sub_buckets) {
+            return i;
+        }
+        const std::size_t log = i / sub_buckets - 1;
+        return ((sub_buckets + i % sub_buckets + 1) << log) - 1;
+    }
+
+    std::vector<std::uint64_t> m_counts = std::vector<std::uint64_t>(bucket_count);
+    std::uint64_t m_total = 0;
+    std::uint64_t m_max = 0;
+};
+
+bool parse(const int argc, char ** argv, options & opts)
+{
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string key = argv[i];
+        const char * value = argv[i + 1];
+        if (key == "--seconds") {
+            opts.seconds = std::strtoull(value, nullptr, 10);
+        }
+        else if (key == "--elements") {
+            opts.elements = std::strtoull(value, nullptr, 10);
+        }
+        else if (key == "--threads") {
+            opts.threads = std::max<std::size_t>(1, std::strtoull(value, nullptr, 10));
+        }
+        else if (key == "--iterate-length") {
+            opts.iterate_length = std::strtoull(value, nullptr, 10);
+        }
+        else if (key == "--mix") {
+            char * end = nullptr;
+            for (auto & weight : opts.mix) {
+                weight = static_cast<unsigned>(std::strtoul(value, &end, 10));
+                value = *end == ',' ? end + 1 : end;
+            }
+        }
+        else {
+            std::cerr << "Unknown option " << key << '\n';
+            return false;
+        }
+    }
+    if (opts.elements == 0) {
+        std::cerr << "--elements has to be positive\n";
+        return false;
+    }
+    if (std::all_of(opts.mix.begin(), opts.mix.end(), [](const unsigned w) { return w == 0; })) {
+        std::cerr << "--mix needs at least one positive weight\n";
+        return false;
+    }
+    return argc % 2 == 1;
+}
+
+// Low percentiles matter most for throughput, they show the stalls
+void print_throughput(const throughput_log & log, const std::size_t op)
+{
+    std::vector<double> rates;
+    for (const auto & row : log) {
+        rates.push_back(static_cast<double>(row[op]) / std::chrono::duration<double>(interval).count());
+    }
+    if (rates.empty()) {
+        return;
+    }
+    std::sort(rates.begin(), rates.end());
+    const auto at = [&rates](const double q) { return rates[static_cast<std::size_t>(q * static_cast<double>(rates.size() - 1))]; };
+    std::cout << " ops/s p1=" << at(0.01) << " p10=" << at(0.1) << " p50=" << at(0.5) << " p99=" << at(0.99);
+}
+
+void print(const options & opts, const std::array<latency_histogram, op_count> & histograms, const throughput_log & log, const double seconds)
+{
+    std::cout << "threads=" << opts.threads << " elements=" << opts.elements << " seconds=" << seconds << '\n';
+    for (std::size_t op = 0; op < op_count; ++op) {
+        const auto & h = histograms[op];
+        if (h.total() == 0) {
+            continue;
+        }
+        std::cout << operation_names[op]
+                  << " ops=" << h.total() * batch_size
+                  << " mean_ops/s=" << static_cast<double>(h.total() * batch_size) / seconds;
+        print_throughput(log, op);
+        std::cout << " latency p50=" << h.percentile(0.5)
+                  << " p90=" << h.percentile(0.9)
+                  << " p99=" << h.percentile(0.99)
+                  << " p999=" << h.percentile(0.999)
+                  << " max=" << h.max() << " ns\n";
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    options opts;
+    if (!parse(argc, argv, opts)) {
+        std::cerr << "usage: " << argv[0] << " [--seconds N] [--elements N] [--threads N] [--iterate-length N] [--mix E,D,S,I]\n";
+        return EXIT_FAILURE;
+    }
+
+    concurrent_randomized_queue<int> mutable_queue(opts.threads);
+    randomized_queue<int> shared_queue;
+    for (std::size_t i = 0; i < opts.elements; ++i) {
+        mutable_queue.enqueue(static_cast<int>(i));
+        shared_queue.enqueue(static_cast<int>(i));
+    }
+    const auto & readonly = shared_queue;
+
+    std::discrete_distribution<std::size_t> choose(opts.mix.begin(), opts.mix.end());
+    std::array<latency_histogram, op_count> histograms;
+    throughput_log log;
+    std::mutex histograms_mutex;
+    std::atomic<std::uint64_t> sink{0};
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::seconds(opts.seconds);
+    {
+        thread_pool pool(opts.threads);
+        for (std::size_t t = 0; t < pool.size(); ++t) {
+            pool.submit([&, t] {
+                std::mt19937_64 rng(std::random_device{}() + t);
+                auto pick = choose;
+                std::array<latency_histogram, op_count> local;
+                throughput_log local_log;
+                std::uint64_t acc = 0;
+                for (auto now = std::chrono::steady_clock::now(); now < deadline;) {
+                    const auto op = pick(rng);
+                    for (std::size_t i = 0; i < batch_size; ++i) {
+                        switch (op) {
+                        case op_enqueue:
+                            mutable_queue.enqueue(static_cast<int>(rng() % opts.elements));
+                            break;
+                        case op_dequeue:
+                            if (auto x = mutable_queue.try_dequeue()) {
+                                acc += static_cast<std::uint64_t>(*x);
+                            }
+                            break;
+                        case op_sample:
+                            acc += static_cast<std::uint64_t>(readonly.sample());
+                            break;
+                        default: {
+                            std::size_t n = 0;
+                            for (auto it = readonly.begin(); it != readonly.end() && n < opts.iterate_length; ++it, ++n) {
+                                acc += static_cast<std::uint64_t>(*it);
+                            }
+                        }
+                        }
+                    }
+                    const auto after = std::chrono::steady_clock::now();
+                    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(after - now).count();
+                    local[op].record(static_cast<std::uint64_t>(elapsed) / batch_size);
+                    const auto slot = static_cast<std::size_t>((after - start) / interval);
+                    if (local_log.size() <= slot) {
+                        local_log.resize(slot + 1);
+                    }
+                    local_log[slot][op] += batch_size;
+                    now = after;
+                }
+                sink.fetch_add(acc, std::memory_order_relaxed);
+                std::lock_guard lock(histograms_mutex);
+                for (std::size_t op = 0; op < op_count; ++op) {
+                    histograms[op].merge(local[op]);
+                }
+                if (log.size() < local_log.size()) {
+                    log.resize(local_log.size());
+                }
+                for (std::size_t i = 0; i < local_log.size(); ++i) {
+                    for (std::size_t op = 0; op < op_count; ++op) {
+                        log[i][op] += local_log[i][op];
+                    }
+                }
+            });
+        }
+        pool.wait();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    // The last interval is cut short by the deadline
+    log.resize(std::min(log.size(), static_cast<std::size_t>(elapsed / interval)));
+    print(opts, histograms, log, elapsed.count());
+    std::cout << "checksum=" << sink.load() << '\n';
+    return EXIT_SUCCESS;
+}
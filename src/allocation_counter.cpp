@@ -0,0 +1,77 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::size_t> g_count{0};
+std::atomic<std::size_t> g_bytes{0};
+std::atomic<std::size_t> g_live{0};
+std::atomic<std::size_t> g_peak{0};
+
+// Every block is prefixed with its size, so that operator delete knows how
+// much memory is released
+constexpr std::size_t header_size = alignof(std::max_align_t);
+
+void update_peak(const std::size_t live)
+{
+    auto peak = g_peak.load(std::memory_order_relaxed);
+    while (peak < live && !g_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+} // anonymous namespace
+
+namespace allocation_counter {
+
+snapshot current()
+{
+    return {g_count.load(std::memory_order_relaxed), g_bytes.load(std::memory_order_relaxed)};
+}
+
+std::size_t live_bytes()
+{
+    return g_live.load(std::memory_order_relaxed);
+}
+
+std::size_t peak_bytes()
+{
+    return g_peak.load(std::memory_order_relaxed);
+}
+
+void reset_peak()
+{
+    g_peak.store(live_bytes(), std::memory_order_relaxed);
+}
+
+} // namespace allocation_counter
+
+void * operator new (std::size_t size)
+{
+    auto * block = static_cast<unsigned char *>(std::malloc(size + header_size));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<std::size_t *>(block) = size;
+    g_count.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+    update_peak(g_live.fetch_add(size, std::memory_order_relaxed) + size);
+    return block + header_size;
+}
+
+void operator delete (void * ptr) noexcept
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    auto * block = static_cast<unsigned char *>(ptr) - header_size;
+    g_live.fetch_sub(*reinterpret_cast<std::size_t *>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete (void * ptr, std::size_t) noexcept
+{
+    operator delete (ptr);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+// Global operator new/delete are replaced in allocation_counter.cpp, so every
+// heap allocation made by the test (or benchmark) binary is accounted here.
+namespace allocation_counter {
+
+struct snapshot
+{
+    std::size_t count = 0; // number of allocations made so far
+    std::size_t bytes = 0; // total number of bytes allocated so far
+};
+
+snapshot current();
+
+// Bytes which are allocated and not yet freed
+std::size_t live_bytes();
+
+// Maximum of live_bytes() since the last reset_peak()
+std::size_t peak_bytes();
+void reset_peak();
+
+inline snapshot operator + (const snapshot & lhs, const snapshot & rhs)
+{
+    return {lhs.count + rhs.count, lhs.bytes + rhs.bytes};
+}
+
+inline snapshot operator - (const snapshot & lhs, const snapshot & rhs)
+{
+    return {lhs.count - rhs.count, lhs.bytes - rhs.bytes};
+}
+
+} // namespace allocation_counter
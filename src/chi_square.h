@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace chi_square {
+
+inline double statistic(const std::vector<std::size_t> & observed, const double expected)
+{
+    double sum = 0;
+    for (const auto o : observed) {
+        const double d = static_cast<double>(o) - expected;
+        sum += d * d / expected;
+    }
+    return sum;
+}
+
+// Upper quantile of the chi-square distribution for a false failure
+// probability of 1e-6, by the Wilson-Hilferty approximation. At one degree of
+// freedom it overestimates the exact quantile (23.9), which only makes the
+// bound more lenient.
+inline double limit(const std::size_t degrees_of_freedom)
+{
+    const double z = 4.7534; // standard normal upper quantile for p = 1e-6
+    const auto dof = static_cast<double>(degrees_of_freedom);
+    const double c = 2 / (9 * dof);
+    const double t = 1 - c + z * std::sqrt(c);
+    return dof * t * t * t;
+}
+
+} // namespace chi_square
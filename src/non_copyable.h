@@ -0,0 +1,32 @@
+#pragma once
+
+namespace test_types {
+
+class NonCopyable
+{
+    int m_data = 0;
+public:
+    NonCopyable() = default;
+    NonCopyable(const int data) : m_data(data) {}
+    NonCopyable(const NonCopyable &) = delete;
+    NonCopyable(NonCopyable &&) = default;
+    NonCopyable & operator = (NonCopyable &&) = default;
+
+    operator int () const { return m_data; }
+    NonCopyable & operator = (const int value)
+    {
+        m_data = value;
+        return *this;
+    }
+
+    NonCopyable & operator *= (const NonCopyable & other)
+    {
+        m_data *= other.m_data;
+        return *this;
+    }
+
+    friend bool operator == (const int lhs, const NonCopyable & rhs)
+    { return lhs == rhs.m_data; }
+};
+
+} // namespace test_types
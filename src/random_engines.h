@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+// Small UniformRandomBitGenerator implementations used to check that
+// randomized_queue accepts a user provided engine. Each one is constructible
+// from an integer seed.
+namespace random_engines {
+
+namespace detail {
+
+inline std::uint64_t splitmix64(std::uint64_t & state)
+{
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+} // namespace detail
+
+// xoshiro256++ by Blackman and Vigna, 32 bytes of state
+class xoshiro256pp
+{
+    std::uint64_t m_s[4];
+
+    static std::uint64_t rotl(const std::uint64_t x, const int k)
+    { return (x << k) | (x >> (64 - k)); }
+
+public:
+    using result_type = std::uint64_t;
+
+    explicit xoshiro256pp(std::uint64_t seed = 0)
+    {
+        for (auto & s : m_s) {
+            s = detail::splitmix64(seed);
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator () ()
+    {
+        const auto result = rotl(m_s[0] + m_s[3], 23) + m_s[0];
+        const auto t = m_s[1] << 17;
+        m_s[2] ^= m_s[0];
+        m_s[3] ^= m_s[1];
+        m_s[1] ^= m_s[2];
+        m_s[0] ^= m_s[3];
+        m_s[2] ^= t;
+        m_s[3] = rotl(m_s[3], 45);
+        return result;
+    }
+};
+
+// PCG32 (XSH RR variant) by O'Neill, 16 bytes of state
+class pcg32
+{
+    std::uint64_t m_state = 0;
+    std::uint64_t m_inc = 0;
+
+public:
+    using result_type = std::uint32_t;
+
+    explicit pcg32(std::uint64_t seed = 0)
+        : m_inc((detail::splitmix64(seed) << 1) | 1)
+    {
+        m_state = detail::splitmix64(seed);
+        (*this)();
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator () ()
+    {
+        const auto old = m_state;
+        m_state = old * 6364136223846793005ULL + m_inc;
+        const auto xorshifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+        const auto rot = static_cast<std::uint32_t>(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+};
+
+// Counter based generator: the n-th output is a pure function of (key, n),
+// so a stream can be replayed from any position with seek()
+class counter_engine
+{
+    std::uint64_t m_key = 0;
+    std::uint64_t m_counter = 0;
+
+public:
+    using result_type = std::uint64_t;
+
+    explicit counter_engine(std::uint64_t seed = 0)
+        : m_key(detail::splitmix64(seed))
+    {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator () ()
+    {
+        std::uint64_t state = m_key ^ (m_counter++ * 0xd1342543de82ef95ULL);
+        return detail::splitmix64(state);
+    }
+
+    void discard(const std::uint64_t n) { m_counter += n; }
+    void seek(const std::uint64_t position) { m_counter = position; }
+    std::uint64_t position() const { return m_counter; }
+};
+
+} // namespace random_engines
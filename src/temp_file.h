@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+
+// File removed when the test leaves its scope
+class temp_file
+{
+    std::filesystem::path m_path;
+public:
+    explicit temp_file(const std::string & content = {})
+        : m_path(std::filesystem::temp_directory_path() / ("randomized_queue_test_" + std::to_string(std::random_device{}())))
+    {
+        std::ofstream(m_path, std::ios::binary) << content;
+    }
+    temp_file(const temp_file &) = delete;
+    temp_file & operator = (const temp_file &) = delete;
+    ~temp_file()
+    {
+        std::error_code ec;
+        std::filesystem::remove(m_path, ec);
+    }
+
+    const std::filesystem::path & path() const { return m_path; }
+};
+
+// Owning std::FILE handle, closed when it leaves its scope
+struct file_closer
+{
+    void operator () (std::FILE * file) const noexcept { std::fclose(file); }
+};
+
+using unique_file = std::unique_ptr<std::FILE, file_closer>;
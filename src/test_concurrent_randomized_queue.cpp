@@ -0,0 +1,154 @@
+#include "concurrent_randomized_queue.h"
+#include "non_copyable.h"
+#include "test_iterator.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+using test_types::NonCopyable;
+
+template <class T>
+struct ConcurrentRandomizedQueueTest : ::testing::Test
+{
+    concurrent_randomized_queue<T> queue;
+
+    T create(const int x)
+    {
+        return x;
+    }
+
+    // Dequeues until the queue reports nothing left and returns the values
+    std::vector<int> drain()
+    {
+        std::vector<int> values;
+        while (auto x = queue.try_dequeue()) {
+            values.push_back(*x);
+        }
+        return values;
+    }
+};
+
+using TestedTypes = ::testing::Types<int, NonCopyable>;
+TYPED_TEST_SUITE(ConcurrentRandomizedQueueTest, TestedTypes);
+
+std::vector<int> iota(const int n)
+{
+    std::vector<int> result(static_cast<std::size_t>(n));
+    std::iota(result.begin(), result.end(), 0);
+    return result;
+}
+
+} // anonymous namespace
+
+TYPED_TEST(ConcurrentRandomizedQueueTest, empty)
+{
+    EXPECT_TRUE(this->queue.empty());
+    EXPECT_EQ(0, this->queue.size());
+    EXPECT_FALSE(this->queue.try_dequeue().has_value());
+}
+
+TYPED_TEST(ConcurrentRandomizedQueueTest, single_thread)
+{
+    const int n = 1000;
+    for (int i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(i));
+    }
+    EXPECT_FALSE(this->queue.empty());
+    EXPECT_EQ(n, this->queue.size());
+
+    auto values = this->drain();
+    EXPECT_TRUE(this->queue.empty());
+    ASSERT_EQ(n, values.size());
+    EXPECT_FALSE(std::is_sorted(values.begin(), values.end()));
+    EXPECT_FALSE(std::is_sorted(values.rbegin(), values.rend()));
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(iota(n), values);
+}
+
+TYPED_TEST(ConcurrentRandomizedQueueTest, steal_from_other_thread)
+{
+    // Everything is produced by one thread, the consumer has to find it
+    // even when its own shard is empty
+    const int n = 100;
+    iterator_test::run_parallel({[this] {
+        for (int i = 0; i < n; ++i) {
+            this->queue.enqueue(this->create(i));
+        }
+    }});
+    std::vector<int> values;
+    iterator_test::run_parallel({[this, &values] { values = this->drain(); }});
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(iota(n), values);
+    EXPECT_TRUE(this->queue.empty());
+}
+
+TYPED_TEST(ConcurrentRandomizedQueueTest, producers_and_consumers)
+{
+    const int producers = 8, consumers = 8, per_producer = 20000;
+    const int total = producers * per_producer;
+
+    std::atomic<int> consumed{0};
+    std::mutex mutex;
+    std::vector<int> values;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    std::vector<std::function<void()>> tasks;
+    for (int p = 0; p < producers; ++p) {
+        tasks.emplace_back([this, p] {
+            for (int i = 0; i < per_producer; ++i) {
+                this->queue.enqueue(this->create(p * per_producer + i));
+            }
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        tasks.emplace_back([this, &consumed, &mutex, &values, deadline] {
+            std::vector<int> local;
+            // A lost element must fail the test, not hang it
+            while (consumed.load() < total && std::chrono::steady_clock::now() < deadline) {
+                if (auto x = this->queue.try_dequeue()) {
+                    local.push_back(*x);
+                    consumed.fetch_add(1);
+                }
+            }
+            std::lock_guard lock(mutex);
+            values.insert(values.end(), local.begin(), local.end());
+        });
+    }
+    iterator_test::run_parallel(tasks);
+
+    ASSERT_EQ(total, consumed.load()) << "Consumers gave up at the deadline";
+    EXPECT_TRUE(this->queue.empty());
+    ASSERT_EQ(total, values.size());
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(iota(total), values) << "Every element has to be dequeued exactly once";
+}
+
+TYPED_TEST(ConcurrentRandomizedQueueTest, interleaved)
+{
+    // Threads enqueue and dequeue at the same time, size never goes wrong
+    const int threads = 8, rounds = 10000;
+    std::atomic<int> dequeued{0};
+    std::vector<std::function<void()>> tasks;
+    for (int t = 0; t < threads; ++t) {
+        tasks.emplace_back([this, t, &dequeued] {
+            for (int i = 0; i < rounds; ++i) {
+                this->queue.enqueue(this->create(t * rounds + i));
+                if (i % 2 == 1 && this->queue.try_dequeue()) {
+                    dequeued.fetch_add(1);
+                }
+            }
+        });
+    }
+    iterator_test::run_parallel(tasks);
+
+    const auto rest = this->drain();
+    EXPECT_EQ(threads * rounds, dequeued.load() + static_cast<int>(rest.size()));
+    EXPECT_TRUE(this->queue.empty());
+}
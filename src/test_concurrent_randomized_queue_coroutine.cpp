@@ -0,0 +1,157 @@
+#include "chi_square.h"
+#include "concurrent_randomized_queue.h"
+#include "test_iterator.h"
+
+#include <gtest/gtest.h>
+
+#if defined(__cpp_impl_coroutine)
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Eagerly started coroutine which nobody awaits
+struct detached_task
+{
+    struct promise_type
+    {
+        detached_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+template <class T>
+detached_task consume(concurrent_randomized_queue<T> & queue, const std::size_t n, std::vector<T> & out, std::mutex & mutex, std::atomic<std::size_t> & done)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        T x = co_await queue.co_dequeue();
+        std::lock_guard lock(mutex);
+        out.push_back(std::move(x));
+    }
+    done.fetch_add(1);
+}
+
+} // anonymous namespace
+
+TEST(ConcurrentRandomizedQueueCoroutineTest, ready_without_suspending)
+{
+    concurrent_randomized_queue<int> queue;
+    for (int i = 0; i < 3; ++i) {
+        queue.enqueue(i);
+    }
+    std::vector<int> out;
+    std::mutex mutex;
+    std::atomic<std::size_t> done{0};
+    consume(queue, 3, out, mutex, done);
+    EXPECT_EQ(1u, done);
+    std::sort(out.begin(), out.end());
+    EXPECT_EQ((std::vector<int>{0, 1, 2}), out);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(ConcurrentRandomizedQueueCoroutineTest, resumed_by_enqueue)
+{
+    concurrent_randomized_queue<std::string> queue;
+    std::vector<std::string> out;
+    std::mutex mutex;
+    std::atomic<std::size_t> done{0};
+    consume(queue, 2, out, mutex, done);
+    EXPECT_EQ(0u, done);
+    EXPECT_TRUE(out.empty());
+
+    queue.enqueue("One");
+    EXPECT_EQ((std::vector<std::string>{"One"}), out);
+    EXPECT_EQ(0u, done);
+    queue.enqueue(std::string("Two"));
+    EXPECT_EQ((std::vector<std::string>{"One", "Two"}), out);
+    EXPECT_EQ(1u, done);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(ConcurrentRandomizedQueueCoroutineTest, batched_wakeup)
+{
+    concurrent_randomized_queue<int> queue;
+    const std::size_t consumers = 100;
+    std::vector<int> out;
+    std::mutex mutex;
+    std::atomic<std::size_t> done{0};
+    for (std::size_t i = 0; i < consumers; ++i) {
+        consume(queue, 1, out, mutex, done);
+    }
+    EXPECT_EQ(0u, done);
+
+    // More elements than waiters, the rest stays in the queue
+    std::vector<int> values(consumers + 10);
+    std::iota(values.begin(), values.end(), 0);
+    queue.enqueue_range(values.begin(), values.end());
+    EXPECT_EQ(consumers, done);
+    EXPECT_EQ(10u, queue.size());
+
+    while (auto x = queue.try_dequeue()) {
+        out.push_back(*x);
+    }
+    std::sort(out.begin(), out.end());
+    EXPECT_EQ(values, out);
+}
+
+TEST(ConcurrentRandomizedQueueCoroutineTest, many_producers)
+{
+    concurrent_randomized_queue<int> queue;
+    const std::size_t producers = 4, consumers = 8, per_producer = 2000;
+    const std::size_t per_consumer = producers * per_producer / consumers;
+    std::vector<int> out;
+    std::mutex mutex;
+    std::atomic<std::size_t> done{0};
+    for (std::size_t i = 0; i < consumers; ++i) {
+        consume(queue, per_consumer, out, mutex, done);
+    }
+
+    std::vector<std::function<void()>> tasks;
+    for (std::size_t p = 0; p < producers; ++p) {
+        tasks.emplace_back([&queue, p, per_producer] {
+            for (std::size_t i = 0; i < per_producer; ++i) {
+                queue.enqueue(static_cast<int>(p * per_producer + i));
+            }
+        });
+    }
+    iterator_test::run_parallel(tasks);
+
+    EXPECT_EQ(consumers, done);
+    EXPECT_TRUE(queue.empty());
+    std::sort(out.begin(), out.end());
+    std::vector<int> expected(producers * per_producer);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(expected, out);
+}
+
+TEST(ConcurrentRandomizedQueueCoroutineTest, uniform)
+{
+    const std::size_t n = 10;
+    const std::size_t per_bin = 1000;
+    std::vector<std::size_t> first(n);
+    for (std::size_t i = 0; i < n * per_bin; ++i) {
+        concurrent_randomized_queue<int> queue;
+        for (std::size_t j = 0; j < n; ++j) {
+            queue.enqueue(static_cast<int>(j));
+        }
+        std::vector<int> out;
+        std::mutex mutex;
+        std::atomic<std::size_t> done{0};
+        consume(queue, 1, out, mutex, done);
+        ++first[static_cast<std::size_t>(out.front())];
+    }
+    EXPECT_LT(chi_square::statistic(first, per_bin), chi_square::limit(n - 1)) << "First co_dequeue() from " << n << " elements is skewed";
+}
+
+#endif
@@ -1,5 +1,11 @@
 #include <thread>
 #include <functional>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#if __has_include(<version>)
+#include <version>
+#endif
 
 #include <gtest/gtest.h>
 
@@ -211,14 +217,13 @@ struct Job
     {}
 };
 
-template<typename Iterator>
-void run_multithread(std::vector<Job<Iterator>> jobs)
+// Runs every task in its own thread and waits for all of them
+inline void run_parallel(const std::vector<std::function<void()>> & tasks)
 {
-    std::cout << "Start " << jobs.size() << " threads\n";
+    std::cout << "Start " << tasks.size() << " threads\n";
     std::vector<std::thread> v;
-    for (const auto & j : jobs) {
-        v.emplace_back([j] ()
-                { auto [b, e] = j.range(); j.test(b, e); });
+    for (const auto & task : tasks) {
+        v.emplace_back(task);
     }
 
     for (auto & t : v) {
@@ -227,13 +232,26 @@ void run_multithread(std::vector<Job<Iterator>> jobs)
     std::cout << "All threads have been joined\n";
 }
 
+template<typename Iterator>
+void run_multithread(std::vector<Job<Iterator>> jobs)
+{
+    std::vector<std::function<void()>> tasks;
+    for (const auto & j : jobs) {
+        tasks.emplace_back([j] ()
+                { auto [b, e] = j.range(); j.test(b, e); });
+    }
+    run_parallel(tasks);
+}
+
 template<typename Iterator>
 void test_basic(Iterator begin, Iterator end)
 {
     static_assert(!std::is_same_v<typename std::iterator_traits<Iterator>::iterator_category(), std::input_iterator_tag>);
     static_assert(!std::is_same_v<typename std::iterator_traits<Iterator>::iterator_category(), std::output_iterator_tag>);
-    // FIXME: uncomment this as soon as C++20 is available
-    // static_assert(!std::is_same_v<typename std::iterator_traits<Iterator>::iterator_category(), std::contiguous_iterator_tag>);
+#if defined(__cpp_lib_ranges)
+    static_assert(!std::is_same_v<typename std::iterator_traits<Iterator>::iterator_category(), std::contiguous_iterator_tag>);
+    static_assert(!std::contiguous_iterator<Iterator>);
+#endif
 
     traits(begin, end, typename std::iterator_traits<Iterator>::iterator_category());
 }
@@ -1,40 +1,29 @@
+#include "allocation_counter.h"
+#include "chi_square.h"
+#include "non_copyable.h"
+#include "random_engines.h"
 #include "randomized_queue.h"
 #include "test_iterator.h"
 
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <memory_resource>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sstream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace {
 
-class NonCopyable
-{
-    int m_data = 0;
-public:
-    NonCopyable() = default;
-    NonCopyable(const int data) : m_data(data) {}
-    NonCopyable(const NonCopyable &) = delete;
-    NonCopyable(NonCopyable &&) = default;
-    NonCopyable & operator = (NonCopyable &&) = default;
-
-    operator int () const { return m_data; }
-    NonCopyable & operator = (const int value)
-    {
-        m_data = value;
-        return *this;
-    }
-
-    NonCopyable & operator *= (const NonCopyable & other)
-    {
-        m_data *= other.m_data;
-        return *this;
-    }
-
-    friend bool operator == (const int lhs, const NonCopyable & rhs)
-    { return lhs == rhs.m_data; }
-};
+using test_types::NonCopyable;
 
 template <class T>
 struct RandomizedQueueTest : ::testing::Test
@@ -68,6 +57,158 @@ struct RandomizedQueueTest : ::testing::Test
 using TestedTypes = ::testing::Types<int, NonCopyable>;
 TYPED_TEST_SUITE(RandomizedQueueTest, TestedTypes);
 
+// Fixture for generic iterator tests over the blocked iteration order
+struct RandomizedQueueBlockedTest : ::testing::Test
+{
+    using view_type = decltype(std::declval<randomized_queue<int> &>().blocked());
+
+    view_type & not_empty_container()
+    {
+        if (!view) {
+            for (const int x : {1, 2, 3, 33, 190}) {
+                sample.enqueue(x);
+            }
+            view.emplace(sample.blocked());
+        }
+        return *view;
+    }
+
+    randomized_queue<int> sample;
+    std::optional<view_type> view;
+};
+
+// Counts how many times values of this type are copied and moved
+class MoveCounter
+{
+    int m_data = 0;
+public:
+    static inline std::size_t copies = 0;
+    static inline std::size_t moves = 0;
+
+    static void reset()
+    {
+        copies = 0;
+        moves = 0;
+    }
+
+    MoveCounter(const int data) : m_data(data) {}
+    MoveCounter(const MoveCounter & other) : m_data(other.m_data) { ++copies; }
+    MoveCounter(MoveCounter && other) noexcept : m_data(other.m_data) { ++moves; }
+    MoveCounter & operator = (const MoveCounter & other)
+    {
+        m_data = other.m_data;
+        ++copies;
+        return *this;
+    }
+    MoveCounter & operator = (MoveCounter && other) noexcept
+    {
+        m_data = other.m_data;
+        ++moves;
+        return *this;
+    }
+
+    operator int () const { return m_data; }
+};
+
+struct Trivial
+{
+    std::int64_t id;
+    double value;
+    std::uint32_t tag;
+};
+
+template <class Rng>
+struct RandomizedQueueRngTest : ::testing::Test
+{
+    randomized_queue<int, Rng> queue;
+
+    // Initialize sample data for generic iterator tests
+    randomized_queue<int, Rng> & not_empty_container()
+    {
+        if (sample.empty()) {
+            for (const int x : {1, 2, 3, 33, 190}) {
+                sample.enqueue(x);
+            }
+        }
+        return sample;
+    }
+
+    randomized_queue<int, Rng> sample;
+};
+
+// Minimal stateful allocator which counts allocations made through it
+template <class T>
+struct counting_allocator
+{
+    using value_type = T;
+
+    std::size_t * count;
+
+    explicit counting_allocator(std::size_t * c) : count(c) {}
+    template <class U>
+    counting_allocator(const counting_allocator<U> & other) : count(other.count) {}
+
+    T * allocate(const std::size_t n)
+    {
+        ++*count;
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T * p, const std::size_t n)
+    { std::allocator<T>{}.deallocate(p, n); }
+
+    friend bool operator == (const counting_allocator & lhs, const counting_allocator & rhs)
+    { return lhs.count == rhs.count; }
+    friend bool operator != (const counting_allocator & lhs, const counting_allocator & rhs)
+    { return !(lhs == rhs); }
+};
+
+// Memory resource which tracks how much memory is currently taken from it
+class counting_resource : public std::pmr::memory_resource
+{
+    std::pmr::memory_resource * m_upstream = std::pmr::new_delete_resource();
+public:
+    std::size_t count = 0;
+    std::size_t live = 0;
+
+private:
+    void * do_allocate(const std::size_t bytes, const std::size_t alignment) override
+    {
+        ++count;
+        live += bytes;
+        return m_upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void * p, const std::size_t bytes, const std::size_t alignment) override
+    {
+        live -= bytes;
+        m_upstream->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override
+    { return this == &other; }
+};
+
+// Replaces the default memory resource and restores the previous one on scope exit
+class default_resource_guard
+{
+    std::pmr::memory_resource * m_previous;
+public:
+    explicit default_resource_guard(std::pmr::memory_resource * resource)
+        : m_previous(std::pmr::set_default_resource(resource))
+    {}
+    default_resource_guard(const default_resource_guard &) = delete;
+    default_resource_guard & operator = (const default_resource_guard &) = delete;
+    ~default_resource_guard()
+    {
+        std::pmr::set_default_resource(m_previous);
+    }
+};
+
+using TestedEngines = ::testing::Types<std::minstd_rand, std::mt19937_64,
+      random_engines::xoshiro256pp, random_engines::pcg32, random_engines::counter_engine>;
+TYPED_TEST_SUITE(RandomizedQueueRngTest, TestedEngines);
+
 } // anonymous namespace
 
 TEST(RandomizedQueueEnqueueTest, enqueue)
@@ -313,5 +454,1009 @@ TYPED_TEST(RandomizedQueueTest, lot_of_modifications)
     EXPECT_EQ(n3 - n1, count);
 }
 
+TYPED_TEST(RandomizedQueueTest, reserve)
+{
+    const std::size_t n = 10000;
+    this->queue.reserve(n);
+    EXPECT_LE(n, this->queue.capacity());
+    EXPECT_TRUE(this->queue.empty());
+
+    const auto before = allocation_counter::current();
+    for (std::size_t i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(static_cast<int>(i)));
+    }
+    EXPECT_EQ(0u, (allocation_counter::current() - before).count);
+    EXPECT_EQ(n, this->queue.size());
+}
+
+TYPED_TEST(RandomizedQueueTest, shrink_to_fit)
+{
+    for (int i = 0; i < 1000; ++i) {
+        this->queue.enqueue(this->create(i));
+    }
+    for (int i = 0; i < 990; ++i) {
+        this->queue.dequeue();
+    }
+    EXPECT_LE(1000u, this->queue.capacity());
+    this->queue.shrink_to_fit();
+    EXPECT_EQ(10u, this->queue.capacity());
+
+    std::vector<int> elements;
+    while (!this->queue.empty()) {
+        elements.push_back(this->queue.dequeue());
+    }
+    for (const int x : elements) {
+        EXPECT_LE(0, x);
+        EXPECT_GT(1000, x);
+    }
+    std::sort(elements.begin(), elements.end());
+    EXPECT_EQ(elements.end(), std::adjacent_find(elements.begin(), elements.end()));
+}
+
+TYPED_TEST(RandomizedQueueTest, no_shrink_by_default)
+{
+    for (int i = 0; i < 10000; ++i) {
+        this->queue.enqueue(this->create(i));
+    }
+    const auto capacity = this->queue.capacity();
+    while (!this->queue.empty()) {
+        this->queue.dequeue();
+    }
+    EXPECT_EQ(capacity, this->queue.capacity());
+}
+
+TYPED_TEST(RandomizedQueueTest, shrink_policy)
+{
+    this->queue.set_shrink_policy({4, 16});
+    const std::size_t n = 100000;
+    for (std::size_t i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(static_cast<int>(i)));
+    }
+    std::vector<int> elements;
+    while (this->queue.size() > 100) {
+        elements.push_back(this->queue.dequeue());
+        EXPECT_GE(4 * this->queue.size() + 4, this->queue.capacity() / 2);
+    }
+    EXPECT_GE(4 * 100u, this->queue.capacity());
+    while (!this->queue.empty()) {
+        elements.push_back(this->queue.dequeue());
+    }
+    EXPECT_LE(16u, this->queue.capacity());
+
+    std::sort(elements.begin(), elements.end());
+    std::vector<int> expected(n);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(expected, elements);
+}
+
+TYPED_TEST(RandomizedQueueTest, shrink_policy_hysteresis)
+{
+    // Oscillating around any size must not reallocate on every step
+    this->queue.set_shrink_policy({4, 0});
+    for (int i = 0; i < 1024; ++i) {
+        this->queue.enqueue(this->create(i));
+    }
+    while (this->queue.size() > 256) {
+        this->queue.dequeue();
+    }
+    const auto before = allocation_counter::current();
+    for (int i = 0; i < 1000; ++i) {
+        this->queue.dequeue();
+        this->queue.enqueue(this->create(i));
+        this->queue.enqueue(this->create(i));
+        this->queue.dequeue();
+    }
+    EXPECT_GE(2u, (allocation_counter::current() - before).count);
+}
+
+TYPED_TEST(RandomizedQueueTest, lazy_begin)
+{
+    const std::size_t n = 100000;
+    for (std::size_t i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(static_cast<int>(i)));
+    }
+
+    // Creating and copying iterators should neither allocate nor touch the elements
+    const auto before = allocation_counter::current();
+    const auto b1 = this->queue.begin();
+    const auto e1 = this->queue.end();
+    const auto b2 = this->queue.cbegin();
+    const auto b3 = this->const_queue().begin();
+    const auto e3 = this->const_queue().end();
+    auto copy = b1;
+    const auto allocated = allocation_counter::current() - before;
+    EXPECT_EQ(0, allocated.count);
+    EXPECT_EQ(0, allocated.bytes);
+
+    // Scan which stops after a few elements
+    std::vector<int> first, second;
+    for (auto it = b1; it != e1 && first.size() < 10; ++it) {
+        first.push_back(*it);
+    }
+    for (auto it = b3; it != e3 && second.size() < 10; ++it) {
+        second.push_back(*it);
+    }
+    EXPECT_EQ(10, first.size());
+    EXPECT_NE(first, second);
+    for (const int x : first) {
+        EXPECT_LE(0, x);
+        EXPECT_GT(static_cast<int>(n), x);
+    }
+    EXPECT_TRUE(copy == b1);
+    EXPECT_EQ(n, static_cast<std::size_t>(e1 - copy));
+    EXPECT_EQ(first[5], copy[5]);
+    EXPECT_EQ(first[9], *(b1 + 9));
+    EXPECT_NE(b2, this->queue.cend());
+}
+
+TYPED_TEST(RandomizedQueueTest, iterator_copies)
+{
+    // Iterators are copied freely by algorithms and users, neither a copy
+    // nor many live iterators may cost memory proportional to size()
+    const int n = 1 << 20;
+    for (int i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(i));
+    }
+    using Iterator = decltype(this->queue.begin());
+    using BlockedIterator = decltype(this->queue.blocked().begin());
+    std::vector<Iterator> iterators;
+    std::vector<BlockedIterator> blocked_iterators;
+    iterators.reserve(1000);
+    blocked_iterators.reserve(1000);
+
+    const auto before = allocation_counter::current();
+    for (int i = 0; i < 500; ++i) {
+        iterators.push_back(this->queue.begin());
+        iterators.push_back(iterators.back());
+        blocked_iterators.push_back(this->queue.blocked().begin());
+        blocked_iterators.push_back(blocked_iterators.back());
+    }
+    const auto end = this->queue.end();
+    const auto found = std::find(iterators[0], end, n / 2);
+    const auto large = std::count_if(iterators[1], end, [](const int x) { return x >= n / 2; });
+    const auto blocked_end = this->queue.blocked().end();
+    const auto blocked_found = std::find(blocked_iterators[0], blocked_end, n / 2);
+    const auto allocated = allocation_counter::current() - before;
+
+    EXPECT_EQ(0, allocated.count);
+    ASSERT_NE(end, found);
+    EXPECT_EQ(n / 2, *found);
+    EXPECT_EQ(n / 2, large);
+    ASSERT_NE(blocked_end, blocked_found);
+    EXPECT_EQ(n / 2, *blocked_found);
+    EXPECT_TRUE(iterators[998] == iterators[999]);
+    EXPECT_TRUE(blocked_iterators[998] == blocked_iterators[999]);
+}
+
+TYPED_TEST(RandomizedQueueTest, iteration_is_permutation)
+{
+    std::size_t enqueued = 0;
+    for (const std::size_t n : {1, 2, 3, 5, 15, 16, 17, 255, 256, 257, 1000, 65537}) {
+        for (; enqueued < n; ++enqueued) {
+            this->queue.enqueue(this->create(static_cast<int>(enqueued)));
+        }
+        std::vector<int> expected(n);
+        std::iota(expected.begin(), expected.end(), 0);
+
+        // Random access has to yield the same order as a sequential pass
+        const auto begin = this->const_queue().begin();
+        const auto end = this->const_queue().end();
+        ASSERT_EQ(static_cast<std::ptrdiff_t>(n), end - begin);
+        std::vector<int> sequential, indexed;
+        std::copy(begin, end, std::back_inserter(sequential));
+        for (std::size_t i = 0; i < n; ++i) {
+            indexed.push_back(begin[static_cast<std::ptrdiff_t>(i)]);
+        }
+        EXPECT_EQ(sequential, indexed);
+        std::sort(indexed.begin(), indexed.end());
+        EXPECT_EQ(expected, indexed) << "Not a permutation of " << n << " elements";
+    }
+}
+
+TYPED_TEST(RandomizedQueueTest, enqueue_range)
+{
+    const int n = 1000;
+    std::vector<TypeParam> values;
+    values.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        values.emplace_back(this->create(i));
+    }
+    this->queue.enqueue(this->create(n));
+    this->queue.enqueue_range(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+    EXPECT_EQ(n + 1, this->queue.size());
+
+    std::vector<int> elements(this->const_queue().begin(), this->const_queue().end());
+    std::sort(elements.begin(), elements.end());
+    std::vector<int> expected(n + 1);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(expected, elements);
+
+    this->queue.enqueue_range(std::make_move_iterator(values.end()), std::make_move_iterator(values.end()));
+    EXPECT_EQ(n + 1, this->queue.size());
+}
+
+TYPED_TEST(RandomizedQueueTest, dequeue_n)
+{
+    const int n = 1000;
+    for (int i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(i));
+    }
+
+    std::vector<TypeParam> taken;
+    auto out = this->queue.dequeue_n(0, std::back_inserter(taken));
+    EXPECT_TRUE(taken.empty());
+    EXPECT_EQ(n, this->queue.size());
+
+    const std::size_t k = 300;
+    out = this->queue.dequeue_n(k, out);
+    ASSERT_EQ(k, taken.size());
+    EXPECT_EQ(n - k, this->queue.size());
+
+    // The rest goes through the returned output iterator
+    this->queue.dequeue_n(this->queue.size(), out);
+    EXPECT_TRUE(this->queue.empty());
+    ASSERT_EQ(n, taken.size());
+
+    std::vector<int> first(taken.begin(), taken.begin() + k);
+    std::vector<int> all(taken.begin(), taken.end());
+    std::vector<int> expected(n);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_FALSE(std::is_sorted(first.begin(), first.end())) << "dequeue_n returned the first " << k << " elements in insertion order";
+    std::sort(all.begin(), all.end());
+    EXPECT_EQ(expected, all);
+}
+
+TYPED_TEST(RandomizedQueueTest, dequeue_all)
+{
+    const int n = 100000;
+    for (int i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(i));
+    }
+    std::vector<TypeParam> out;
+    out.reserve(n);
+    auto it = this->queue.dequeue_all(std::back_inserter(out));
+    EXPECT_TRUE(this->queue.empty());
+    ASSERT_EQ(n, out.size());
+
+    std::vector<int> values(out.begin(), out.end());
+    EXPECT_FALSE(std::is_sorted(values.begin(), values.end()));
+    std::sort(values.begin(), values.end());
+    std::vector<int> expected(n);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(expected, values);
+
+    // Empty queue leaves the output alone
+    this->queue.dequeue_all(it);
+    EXPECT_EQ(n, out.size());
+}
+
+TEST(RandomizedQueueBatchTest, dequeue_all_moves_once)
+{
+    const std::size_t n = 10000;
+    randomized_queue<MoveCounter> queue;
+    for (std::size_t i = 0; i < n; ++i) {
+        queue.enqueue(MoveCounter(static_cast<int>(i)));
+    }
+    std::vector<MoveCounter> out;
+    out.reserve(n);
+    MoveCounter::reset();
+    queue.dequeue_all(std::back_inserter(out));
+    EXPECT_EQ(0, MoveCounter::copies);
+    EXPECT_EQ(n, MoveCounter::moves);
+    EXPECT_EQ(n, out.size());
+}
+
+TYPED_TEST(RandomizedQueueTest, emplace)
+{
+    for (int i = 0; i < 100; ++i) {
+        const auto & x = this->queue.emplace(i);
+        EXPECT_EQ(i, x);
+    }
+    EXPECT_EQ(100u, this->queue.size());
+
+    std::vector<int> elements;
+    TypeParam x = this->create(-1);
+    while (!this->queue.empty()) {
+        this->queue.dequeue_into(x);
+        elements.push_back(x);
+    }
+    std::sort(elements.begin(), elements.end());
+    std::vector<int> expected(100);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(expected, elements);
+}
+
+TEST(RandomizedQueueEmplaceTest, emplace_multiple_arguments)
+{
+    randomized_queue<std::string> queue;
+    queue.emplace(3, 'x');
+    queue.emplace("Hallo wereld", 5);
+    std::vector<std::string> elements(queue.begin(), queue.end());
+    std::sort(elements.begin(), elements.end());
+    EXPECT_EQ((std::vector<std::string>{"Hallo", "xxx"}), elements);
+}
+
+TEST(RandomizedQueueEmplaceTest, emplace_constructs_in_place)
+{
+    const std::size_t n = 1000;
+    randomized_queue<MoveCounter> queue;
+    queue.reserve(n);
+    MoveCounter::reset();
+    for (std::size_t i = 0; i < n; ++i) {
+        queue.emplace(static_cast<int>(i));
+    }
+    EXPECT_EQ(0, MoveCounter::copies);
+    EXPECT_EQ(0, MoveCounter::moves);
+}
+
+TEST(RandomizedQueueEmplaceTest, dequeue_moves)
+{
+    // One move out of the chosen slot, one move of the back element into the hole
+    const std::size_t n = 1000;
+    randomized_queue<MoveCounter> queue;
+    for (std::size_t i = 0; i < n; ++i) {
+        queue.emplace(static_cast<int>(i));
+    }
+    MoveCounter::reset();
+    for (std::size_t i = 0; i < n / 2; ++i) {
+        const MoveCounter x = queue.dequeue();
+        EXPECT_GT(static_cast<int>(n), x);
+    }
+    EXPECT_EQ(0, MoveCounter::copies);
+    EXPECT_GE(n, MoveCounter::moves);
+
+    MoveCounter::reset();
+    MoveCounter x = -1;
+    while (!queue.empty()) {
+        queue.dequeue_into(x);
+    }
+    EXPECT_EQ(0, MoveCounter::copies);
+    EXPECT_GE(n, MoveCounter::moves);
+    EXPECT_LE(n / 2, MoveCounter::moves);
+}
+
+TEST(RandomizedQueueBatchTest, dequeue_all_uniform)
+{
+    // All 24 orders of 4 elements have to be equally likely
+    const std::size_t per_bin = 500;
+    std::vector<std::size_t> counts(24);
+    std::vector<int> order(4);
+    for (std::size_t r = 0; r < counts.size() * per_bin; ++r) {
+        randomized_queue<int> queue;
+        for (int i = 0; i < 4; ++i) {
+            queue.enqueue(i);
+        }
+        queue.dequeue_all(order.begin());
+        // Lehmer code of the permutation
+        std::size_t code = 0;
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            const auto smaller_after = std::count_if(order.begin() + static_cast<std::ptrdiff_t>(i) + 1, order.end(),
+                    [&](const int x) { return x < order[i]; });
+            code = code * (order.size() - i) + static_cast<std::size_t>(smaller_after);
+        }
+        ++counts[code];
+    }
+    EXPECT_LT(chi_square::statistic(counts, per_bin), chi_square::limit(counts.size() - 1));
+}
+
+TYPED_TEST(RandomizedQueueTest, blocked_order)
+{
+    std::size_t enqueued = 0;
+    for (const std::size_t n : {1, 11, 300000}) {
+        for (; enqueued < n; ++enqueued) {
+            this->queue.enqueue(this->create(static_cast<int>(enqueued)));
+        }
+        std::vector<int> expected(n);
+        std::iota(expected.begin(), expected.end(), 0);
+
+        const auto view = this->queue.blocked();
+        std::vector<int> mutable_order(view.begin(), view.end());
+        EXPECT_EQ(mutable_order, std::vector<int>(view.begin(), view.end())) << "Order has to be stable";
+        for (std::size_t i = 0; i < n; i += 997) {
+            EXPECT_EQ(mutable_order[i], view.begin()[static_cast<std::ptrdiff_t>(i)]);
+        }
+
+        const auto const_view = this->const_queue().blocked();
+        std::vector<int> const_order(const_view.begin(), const_view.end());
+        if (n > 10) {
+            EXPECT_NE(mutable_order, const_order);
+        }
+        std::sort(mutable_order.begin(), mutable_order.end());
+        std::sort(const_order.begin(), const_order.end());
+        EXPECT_EQ(expected, mutable_order);
+        EXPECT_EQ(expected, const_order);
+    }
+
+    for (auto & x : this->queue.blocked()) {
+        x = -1;
+    }
+    for (const auto & x : this->queue) {
+        EXPECT_EQ(-1, x);
+    }
+}
+
+TEST(RandomizedQueueBlockedOrderTest, first_element_uniform)
+{
+    // A partial last block would make its elements more likely to come
+    // first, so n is a whole number of blocks and each bin is one block
+    const std::size_t bins = 128, per_bin = 200;
+    const std::size_t n = bins * randomized_queue<int>::block_size();
+    randomized_queue<int> queue;
+    for (std::size_t i = 0; i < n; ++i) {
+        queue.enqueue(static_cast<int>(i));
+    }
+    std::vector<std::size_t> counts(bins);
+    for (std::size_t i = 0; i < bins * per_bin; ++i) {
+        ++counts[static_cast<std::size_t>(*queue.blocked().begin()) * bins / n];
+    }
+    EXPECT_LT(chi_square::statistic(counts, per_bin), chi_square::limit(bins - 1));
+}
+
+TEST(RandomizedQueueBlockedOrderTest, consecutive_elements_are_close)
+{
+    // Elements are stored in enqueue order, so in the blocked order most
+    // neighbours come from the same block. For the plain order only about
+    // a quarter of neighbours are closer than n / 8.
+    const int n = 1 << 22;
+    randomized_queue<int> queue;
+    for (int i = 0; i < n; ++i) {
+        queue.enqueue(i);
+    }
+    const auto close_fraction = [n](auto begin, const auto end) {
+        std::size_t close = 0;
+        for (auto prev = begin++; begin != end; prev = begin++) {
+            if (std::abs(*begin - *prev) < n / 8) {
+                ++close;
+            }
+        }
+        return static_cast<double>(close) / (n - 1);
+    };
+    const auto view = queue.blocked();
+    EXPECT_LT(0.5, close_fraction(view.begin(), view.end()));
+    EXPECT_GT(0.5, close_fraction(queue.begin(), queue.end()));
+}
+
+TYPED_TEST(RandomizedQueueTest, erase)
+{
+    const int n = 100;
+    for (int i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(i));
+    }
+
+    // Erasing invalidates every iterator, so each lookup starts over
+    std::vector<int> expected;
+    for (int i = 0; i < n; ++i) {
+        if (i % 3 == 0) {
+            const auto it = std::find(this->queue.begin(), this->queue.end(), i);
+            ASSERT_NE(this->queue.end(), it);
+            this->queue.erase(it);
+        }
+        else if (i % 3 == 1) {
+            const auto it = std::find(this->queue.cbegin(), this->queue.cend(), i);
+            ASSERT_NE(this->queue.cend(), it);
+            this->queue.erase(it);
+        }
+        else {
+            expected.push_back(i);
+        }
+    }
+    EXPECT_EQ(expected.size(), this->queue.size());
+    std::vector<int> rest(this->queue.begin(), this->queue.end());
+    std::sort(rest.begin(), rest.end());
+    EXPECT_EQ(expected, rest);
+
+    // The element just visited can be removed
+    while (!this->queue.empty()) {
+        const auto it = this->queue.begin();
+        const int x = *it;
+        this->queue.erase(it);
+        EXPECT_EQ(this->queue.end(), std::find(this->queue.begin(), this->queue.end(), x));
+    }
+}
+
+TYPED_TEST(RandomizedQueueTest, for_each_and_remove_if)
+{
+    const int n = 10000;
+    for (int i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(i));
+    }
+    std::vector<int> visited;
+    this->queue.for_each_and_remove_if([&visited](TypeParam & x) {
+        visited.push_back(x);
+        if (x % 2 == 0) {
+            return true;
+        }
+        x = -x;
+        return false;
+    });
+    ASSERT_EQ(n, visited.size());
+    EXPECT_FALSE(std::is_sorted(visited.begin(), visited.end())) << "Elements have to be visited in random order";
+    std::sort(visited.begin(), visited.end());
+    std::vector<int> expected(n);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(expected, visited);
+
+    // Kept elements stay, along with the changes made by the predicate
+    EXPECT_EQ(n / 2, this->queue.size());
+    std::vector<int> rest(this->queue.begin(), this->queue.end());
+    std::sort(rest.begin(), rest.end());
+    expected.clear();
+    for (int i = n - 1; i > 0; i -= 2) {
+        expected.push_back(-i);
+    }
+    EXPECT_EQ(expected, rest);
+
+    this->queue.for_each_and_remove_if([](const TypeParam &) { return true; });
+    EXPECT_TRUE(this->queue.empty());
+    this->queue.for_each_and_remove_if([](const TypeParam &) { return true; });
+    EXPECT_TRUE(this->queue.empty());
+}
+
+TYPED_TEST(RandomizedQueueTest, sample_n)
+{
+    const int n = 1000;
+    for (int i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(i));
+    }
+    for (const std::size_t k : {0, 1, 5, 100, 700, 1000}) {
+        // References to the elements, so that NonCopyable can be sampled too
+        std::vector<std::reference_wrapper<const TypeParam>> out;
+        auto it = this->const_queue().sample_n(k, std::back_inserter(out));
+        *it = this->const_queue().sample();
+        ASSERT_EQ(k + 1, out.size());
+        out.pop_back();
+
+        std::vector<int> values;
+        for (const TypeParam & x : out) {
+            values.push_back(x);
+        }
+        std::sort(values.begin(), values.end());
+        EXPECT_EQ(values.end(), std::adjacent_find(values.begin(), values.end())) << "Elements have to be distinct";
+        for (const int x : values) {
+            ASSERT_LE(0, x);
+            ASSERT_GT(n, x);
+        }
+        EXPECT_EQ(n, this->queue.size());
+    }
+}
+
+TYPED_TEST(RandomizedQueueTest, sample_n_uniform)
+{
+    // Every element is included with probability k / n, both for small k
+    // and for k close to n
+    const std::size_t n = 10, runs = 10000;
+    for (std::size_t i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(static_cast<int>(i)));
+    }
+    for (const std::size_t k : {2, 8}) {
+        std::vector<std::size_t> counts(n);
+        std::vector<int> out;
+        for (std::size_t r = 0; r < runs; ++r) {
+            out.clear();
+            this->const_queue().sample_n(k, std::back_inserter(out));
+            for (const int x : out) {
+                ++counts[static_cast<std::size_t>(x)];
+            }
+        }
+        const double expected = static_cast<double>(runs * k) / n;
+        EXPECT_LT(chi_square::statistic(counts, expected), chi_square::limit(n - 1)) << "k = " << k;
+    }
+}
+
+TEST(RandomizedQueueBatchTest, sample_n_does_not_move)
+{
+    randomized_queue<MoveCounter> queue;
+    for (int i = 0; i < 1000; ++i) {
+        queue.enqueue(MoveCounter(i));
+    }
+    std::vector<std::reference_wrapper<const MoveCounter>> refs;
+    std::vector<MoveCounter> copies;
+    copies.reserve(500);
+    MoveCounter::reset();
+    queue.sample_n(10, std::back_inserter(refs));
+    queue.sample_n(500, std::back_inserter(refs));
+    EXPECT_EQ(0, MoveCounter::copies);
+    EXPECT_EQ(0, MoveCounter::moves);
+    queue.sample_n(500, std::back_inserter(copies));
+    EXPECT_EQ(500, MoveCounter::copies);
+    EXPECT_EQ(0, MoveCounter::moves);
+    EXPECT_EQ(1000, queue.size());
+}
+
+TEST(RandomizedQueueBatchTest, enqueue_range_input_iterator)
+{
+    std::istringstream input("5 4 3 2 1");
+    randomized_queue<int> queue;
+    queue.enqueue_range(std::istream_iterator<int>(input), std::istream_iterator<int>());
+    EXPECT_EQ(5, queue.size());
+
+    std::vector<int> elements;
+    queue.dequeue_n(queue.size(), std::back_inserter(elements));
+    std::sort(elements.begin(), elements.end());
+    EXPECT_EQ((std::vector<int>{1, 2, 3, 4, 5}), elements);
+}
+
+TEST(RandomizedQueueBatchTest, enqueue_range_copies_lvalues)
+{
+    const std::vector<std::string> lines = {"One", "Two", "Three"};
+    randomized_queue<std::string> queue;
+    queue.enqueue_range(lines.begin(), lines.end());
+    EXPECT_EQ(3, queue.size());
+    EXPECT_EQ("One", lines[0]);
+
+    std::vector<std::string> elements;
+    queue.dequeue_n(2, std::back_inserter(elements));
+    EXPECT_EQ(1, queue.size());
+    elements.push_back(queue.dequeue());
+    std::sort(elements.begin(), elements.end());
+    EXPECT_EQ((std::vector<std::string>{"One", "Three", "Two"}), elements);
+}
+
+TEST(RandomizedQueueTrivialTest, enqueue_range_and_growth)
+{
+    static_assert(std::is_trivially_copyable_v<Trivial>);
+    const std::size_t n = 1'000'000;
+    std::vector<Trivial> values(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        values[i] = {static_cast<std::int64_t>(i), static_cast<double>(i) / 2, static_cast<std::uint32_t>(i % 7)};
+    }
+
+    randomized_queue<Trivial> queue;
+    queue.enqueue(values[0]);
+    queue.enqueue_range(values.begin() + 1, values.begin() + n / 2);
+    queue.enqueue_range(values.data() + n / 2, values.data() + n);
+    EXPECT_EQ(n, queue.size());
+
+    std::vector<bool> seen(n);
+    while (!queue.empty()) {
+        const auto x = queue.dequeue();
+        ASSERT_LE(0, x.id);
+        ASSERT_GT(static_cast<std::int64_t>(n), x.id);
+        const auto i = static_cast<std::size_t>(x.id);
+        EXPECT_EQ(values[i].value, x.value);
+        EXPECT_EQ(values[i].tag, x.tag);
+        EXPECT_FALSE(seen[i]);
+        seen[i] = true;
+    }
+    EXPECT_EQ(seen.end(), std::find(seen.begin(), seen.end(), false));
+}
+
+TEST(RandomizedQueueTrivialTest, forward_range_allocates_once)
+{
+    // Only the allocation count is checked, the bulk and the element by
+    // element path both reserve once for a forward range. Their speed is
+    // compared by BM_EnqueueRangeCopy.
+    const std::vector<int> values(100'000, 7);
+    randomized_queue<int> queue;
+    const auto before = allocation_counter::current();
+    queue.enqueue_range(values.begin(), values.end());
+    EXPECT_EQ(1u, (allocation_counter::current() - before).count);
+    EXPECT_EQ(values.size(), queue.size());
+}
+
+TEST(RandomizedQueueTrivialTest, dequeue_last_element)
+{
+    // Swapping the back element with itself has to keep the value intact
+    randomized_queue<int> queue;
+    for (int round = 0; round < 1000; ++round) {
+        queue.enqueue(round);
+        EXPECT_EQ(round, queue.dequeue());
+        EXPECT_TRUE(queue.empty());
+    }
+}
+
+TEST(RandomizedQueueTrivialTest, converting_range)
+{
+    // Elements of another type still go through the converting constructor
+    const std::vector<short> values = {1, 2, 3};
+    randomized_queue<long> queue;
+    queue.enqueue_range(values.begin(), values.end());
+    std::vector<long> elements(queue.begin(), queue.end());
+    std::sort(elements.begin(), elements.end());
+    EXPECT_EQ((std::vector<long>{1, 2, 3}), elements);
+}
+
+TYPED_TEST(RandomizedQueueRngTest, operations)
+{
+    const int n = 100;
+    for (int i = 0; i < n; ++i) {
+        this->queue.enqueue(i);
+    }
+    std::vector<int> expected(n);
+    std::iota(expected.begin(), expected.end(), 0);
+
+    for (int i = 0; i < 100; ++i) {
+        const int x = this->queue.sample();
+        EXPECT_LE(0, x);
+        EXPECT_GT(n, x);
+    }
+
+    std::vector<int> order(this->queue.begin(), this->queue.end());
+    EXPECT_NE(expected, order);
+    std::sort(order.begin(), order.end());
+    EXPECT_EQ(expected, order);
+
+    std::vector<int> dequeued;
+    while (!this->queue.empty()) {
+        dequeued.push_back(this->queue.dequeue());
+    }
+    EXPECT_NE(expected, dequeued);
+    std::sort(dequeued.begin(), dequeued.end());
+    EXPECT_EQ(expected, dequeued);
+}
+
+TYPED_TEST(RandomizedQueueRngTest, independent_streams)
+{
+    // Each queue has to seed its own engine, default constructed engines
+    // would make all queues produce the same sequence
+    randomized_queue<int, TypeParam> q1, q2, q3;
+    for (int i = 0; i < 50; ++i) {
+        q1.enqueue(i);
+        q2.enqueue(i);
+        q3.enqueue(i);
+    }
+    // Equal 16-sample prefixes from fair engines have probability 50^-16
+    std::vector<int> s1, s2, s3;
+    for (int i = 0; i < 16; ++i) {
+        s1.push_back(q1.sample());
+        s2.push_back(q2.sample());
+        s3.push_back(q3.sample());
+    }
+    EXPECT_NE(s1, s2);
+    EXPECT_NE(s1, s3);
+    EXPECT_NE(s2, s3);
+
+    const std::vector<int> v1(q1.cbegin(), q1.cend()), v2(q2.cbegin(), q2.cend());
+    EXPECT_NE(v1, v2);
+}
+
+TYPED_TEST(RandomizedQueueRngTest, sample_uniform)
+{
+    for (const std::size_t n : {2, 7, 1000}) {
+        randomized_queue<int, TypeParam> queue;
+        for (std::size_t i = 0; i < n; ++i) {
+            queue.enqueue(static_cast<int>(i));
+        }
+        const std::size_t per_bin = 200;
+        std::vector<std::size_t> counts(n);
+        for (std::size_t i = 0; i < n * per_bin; ++i) {
+            const int x = queue.sample();
+            ASSERT_LE(0, x);
+            ASSERT_GT(static_cast<int>(n), x);
+            ++counts[static_cast<std::size_t>(x)];
+        }
+        EXPECT_EQ(counts.end(), std::find(counts.begin(), counts.end(), 0));
+        EXPECT_LT(chi_square::statistic(counts, per_bin), chi_square::limit(n - 1)) << "Sampling from " << n << " elements is skewed";
+    }
+}
+
+TYPED_TEST(RandomizedQueueRngTest, dequeue_uniform)
+{
+    const std::size_t n = 10;
+    const std::size_t per_bin = 2000;
+    std::vector<std::size_t> first(n), last(n);
+    for (std::size_t i = 0; i < n * per_bin; ++i) {
+        randomized_queue<int, TypeParam> queue;
+        for (std::size_t j = 0; j < n; ++j) {
+            queue.enqueue(static_cast<int>(j));
+        }
+        ++first[static_cast<std::size_t>(queue.dequeue())];
+        while (queue.size() > 1) {
+            queue.dequeue();
+        }
+        ++last[static_cast<std::size_t>(queue.dequeue())];
+    }
+    EXPECT_LT(chi_square::statistic(first, per_bin), chi_square::limit(n - 1));
+    EXPECT_LT(chi_square::statistic(last, per_bin), chi_square::limit(n - 1));
+}
+
+TYPED_TEST(RandomizedQueueRngTest, seeded_replay)
+{
+    // Two queues with the same seed and the same history have to agree on
+    // every random choice
+    randomized_queue<int, TypeParam> q1(42), q2(42);
+    for (int i = 0; i < 100; ++i) {
+        q1.enqueue(i);
+        q2.enqueue(i);
+    }
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_EQ(q1.sample(), q2.sample());
+    }
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(std::vector<int>(q1.begin(), q1.end()), std::vector<int>(q2.begin(), q2.end()));
+    }
+    while (!q1.empty()) {
+        EXPECT_EQ(q1.dequeue(), q2.dequeue());
+    }
+    EXPECT_TRUE(q2.empty());
+}
+
+TYPED_TEST(RandomizedQueueRngTest, seeded_iteration_generations)
+{
+    randomized_queue<int, TypeParam> q1(7), q2(7);
+    for (int i = 0; i < 100; ++i) {
+        q1.enqueue(i);
+        q2.enqueue(i);
+    }
+    const std::vector<int> first(q1.begin(), q1.end());
+    const std::vector<int> second(q1.cbegin(), q1.cend());
+    EXPECT_NE(first, second);
+
+    // The order of the k-th begin() depends only on the seed and k, not on
+    // the samples drawn in between
+    EXPECT_EQ(first, std::vector<int>(q2.begin(), q2.end()));
+    for (int i = 0; i < 10; ++i) {
+        q2.sample();
+    }
+    EXPECT_EQ(second, std::vector<int>(q2.begin(), q2.end()));
+}
+
+TYPED_TEST(RandomizedQueueRngTest, different_seeds)
+{
+    randomized_queue<int, TypeParam> q1(1), q2(2);
+    for (int i = 0; i < 100; ++i) {
+        q1.enqueue(i);
+        q2.enqueue(i);
+    }
+    EXPECT_NE(std::vector<int>(q1.begin(), q1.end()), std::vector<int>(q2.begin(), q2.end()));
+
+    std::vector<int> d1, d2;
+    while (!q1.empty()) {
+        d1.push_back(q1.dequeue());
+        d2.push_back(q2.dequeue());
+    }
+    EXPECT_NE(d1, d2);
+}
+
+TYPED_TEST(RandomizedQueueTest, custom_allocator)
+{
+    using allocator = counting_allocator<TypeParam>;
+    std::size_t count = 0;
+    randomized_queue<TypeParam, random_engines::xoshiro256pp, allocator> queue{allocator(&count)};
+    EXPECT_EQ(&count, queue.get_allocator().count);
+
+    const int n = 1000;
+    for (int i = 0; i < n; ++i) {
+        queue.enqueue(this->create(i));
+    }
+    EXPECT_LT(0, count);
+    std::vector<int> elements;
+    while (!queue.empty()) {
+        elements.push_back(queue.dequeue());
+    }
+    std::sort(elements.begin(), elements.end());
+    std::vector<int> expected(n);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(expected, elements);
+}
+
+TEST(RandomizedQueuePmrTest, everything_from_arena)
+{
+    // Arena without upstream: any allocation which bypasses it either throws
+    // or shows up in the global allocation counter
+    std::vector<std::byte> buffer(1 << 20);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+    const auto before = allocation_counter::current();
+    {
+        pmr::randomized_queue<std::pmr::string> queue(&arena);
+        for (int i = 0; i < 1000; ++i) {
+            std::pmr::string s("string which is too long for small string optimization #", &arena);
+            s += static_cast<char>('0' + i % 10);
+            queue.enqueue(std::move(s));
+        }
+        std::size_t count = 0;
+        for (const auto & s : queue) {
+            EXPECT_EQ(0, s.rfind("string which", 0));
+            ++count;
+        }
+        EXPECT_EQ(1000, count);
+        for (int i = 0; i < 500; ++i) {
+            const auto s = queue.dequeue();
+            EXPECT_EQ(&arena, s.get_allocator().resource());
+        }
+        EXPECT_EQ(500, queue.size());
+    }
+    EXPECT_EQ(0, (allocation_counter::current() - before).count);
+}
+
+TEST(RandomizedQueuePmrTest, pool_churn)
+{
+    counting_resource upstream;
+    {
+        std::pmr::unsynchronized_pool_resource pool(&upstream);
+        pmr::randomized_queue<std::pmr::string> queue(&pool);
+        {
+            // Any allocation from the default resource would throw
+            const default_resource_guard guard(std::pmr::null_memory_resource());
+            for (int round = 0; round < 3; ++round) {
+                for (int i = 0; i < 70000; ++i) {
+                    queue.enqueue(std::pmr::string(40, static_cast<char>('a' + i % 26), queue.get_allocator()));
+                }
+                for (int i = 0; i < 50000; ++i) {
+                    EXPECT_EQ(40, queue.dequeue().size());
+                }
+            }
+        }
+        EXPECT_EQ(60000, queue.size());
+        EXPECT_LT(0, upstream.count);
+    }
+    EXPECT_EQ(0, upstream.live);
+}
+
+TEST(RandomizedQueueThreadsTest, concurrent_const_iteration)
+{
+    randomized_queue<int> queue;
+    for (int i = 0; i < 1000; ++i) {
+        queue.enqueue(i);
+    }
+    const auto & const_queue = queue;
+    using Iterator = decltype(const_queue.begin());
+    std::vector<iterator_test::Job<Iterator>> jobs;
+    for (int i = 0; i < 8; ++i) {
+        jobs.emplace_back([&const_queue] { return std::make_pair(const_queue.begin(), const_queue.end()); },
+                iterator_test::test_multipass<Iterator>);
+    }
+    iterator_test::run_multithread(jobs);
+}
+
+TEST(RandomizedQueueThreadsTest, concurrent_const_sample)
+{
+    const int n = 1000, threads = 8;
+    randomized_queue<int> queue;
+    for (int i = 0; i < n; ++i) {
+        queue.enqueue(i);
+    }
+    const auto & const_queue = queue;
+
+    // Threads must not share one stream, so each of them sees its own order
+    std::vector<std::vector<int>> orders(threads), samples(threads);
+    std::vector<std::function<void()>> tasks;
+    for (int t = 0; t < threads; ++t) {
+        tasks.emplace_back([&const_queue, &orders, &samples, t] {
+            auto & order = orders[static_cast<std::size_t>(t)];
+            auto & sample = samples[static_cast<std::size_t>(t)];
+            for (int i = 0; i < 100; ++i) {
+                order.assign(const_queue.begin(), const_queue.end());
+            }
+            for (int i = 0; i < 10000; ++i) {
+                sample.push_back(const_queue.sample());
+            }
+        });
+    }
+    iterator_test::run_parallel(tasks);
+
+    std::vector<int> expected(n);
+    std::iota(expected.begin(), expected.end(), 0);
+    for (int t = 0; t < threads; ++t) {
+        auto order = orders[static_cast<std::size_t>(t)];
+        for (int u = 0; u < t; ++u) {
+            EXPECT_NE(orders[static_cast<std::size_t>(u)], order);
+            EXPECT_NE(samples[static_cast<std::size_t>(u)], samples[static_cast<std::size_t>(t)]);
+        }
+        std::sort(order.begin(), order.end());
+        EXPECT_EQ(expected, order);
+        for (const int x : samples[static_cast<std::size_t>(t)]) {
+            ASSERT_LE(0, x);
+            ASSERT_GT(n, x);
+        }
+    }
+}
+
+TEST(RandomizedQueueEngineTest, compact_state)
+{
+    using heavy = randomized_queue<int, std::mt19937>;
+    using xoshiro = randomized_queue<int, random_engines::xoshiro256pp>;
+    using pcg = randomized_queue<int, random_engines::pcg32>;
+    EXPECT_LT(sizeof(xoshiro), sizeof(heavy));
+    EXPECT_LE(sizeof(pcg), sizeof(xoshiro));
+}
+
 using TypesToTest = ::testing::Types<RandomizedQueueTest<int>>;
 INSTANTIATE_TYPED_TEST_SUITE_P(RandomizedQueue, IteratorTest, TypesToTest);
+
+INSTANTIATE_TYPED_TEST_SUITE_P(RandomizedQueueBlocked, IteratorTest, RandomizedQueueBlockedTest);
+
+using EngineTypesToTest = ::testing::Types<RandomizedQueueRngTest<random_engines::xoshiro256pp>,
+      RandomizedQueueRngTest<random_engines::counter_engine>>;
+INSTANTIATE_TYPED_TEST_SUITE_P(RandomizedQueueEngine, IteratorTest, EngineTypesToTest);
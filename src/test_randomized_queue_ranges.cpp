@@ -0,0 +1,162 @@
+#include "allocation_counter.h"
+#include "chi_square.h"
+#include "randomized_queue.h"
+#include "test_iterator.h"
+
+#include <gtest/gtest.h>
+
+#if defined(__cpp_lib_ranges)
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using queue_t = randomized_queue<int>;
+
+static_assert(std::random_access_iterator<queue_t::iterator>);
+static_assert(std::random_access_iterator<queue_t::const_iterator>);
+static_assert(std::sized_sentinel_for<queue_t::iterator, queue_t::iterator>);
+static_assert(std::sized_sentinel_for<queue_t::const_iterator, queue_t::const_iterator>);
+static_assert(std::ranges::random_access_range<queue_t>);
+static_assert(std::ranges::random_access_range<const queue_t>);
+static_assert(std::ranges::sized_range<queue_t>);
+static_assert(!std::contiguous_iterator<queue_t::iterator>);
+
+queue_t make_queue(const int n)
+{
+    queue_t queue;
+    for (int i = 0; i < n; ++i) {
+        queue.enqueue(i);
+    }
+    return queue;
+}
+
+// Generic iterator tests, with __cpp_lib_ranges they check the C++20 iterator concepts too
+template <bool Const>
+struct RandomizedQueueRangesIteratorTest : ::testing::Test
+{
+    std::conditional_t<Const, const queue_t &, queue_t &> not_empty_container()
+    {
+        if (sample.empty()) {
+            for (const int x : {1, 2, 3, 33, 190}) {
+                sample.enqueue(x);
+            }
+        }
+        return sample;
+    }
+
+    queue_t sample;
+};
+
+struct RandomizedQueueRangesBlockedTest : ::testing::Test
+{
+    using view_type = decltype(std::declval<queue_t &>().blocked());
+
+    view_type & not_empty_container()
+    {
+        if (!view) {
+            for (const int x : {1, 2, 3, 33, 190}) {
+                sample.enqueue(x);
+            }
+            view.emplace(sample.blocked());
+        }
+        return *view;
+    }
+
+    queue_t sample;
+    std::optional<view_type> view;
+};
+
+} // anonymous namespace
+
+TEST(RandomizedQueueRangesTest, algorithms)
+{
+    auto queue = make_queue(1000);
+    EXPECT_EQ(1000, std::ranges::distance(queue));
+    EXPECT_EQ(1000u, std::ranges::size(queue));
+
+    auto it = std::ranges::begin(queue);
+    std::ranges::advance(it, 500);
+    EXPECT_EQ(500, std::ranges::end(queue) - it);
+
+    std::vector<int> elements;
+    std::ranges::copy(queue, std::back_inserter(elements));
+    std::ranges::sort(elements);
+    std::vector<int> expected(1000);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(expected, elements);
+
+    EXPECT_EQ(999, *std::ranges::max_element(std::as_const(queue)));
+}
+
+TEST(RandomizedQueueRangesTest, random_sample)
+{
+    auto queue = make_queue(1000);
+    auto sample = queue | views::random_sample(10);
+    EXPECT_EQ(10, std::ranges::distance(sample));
+
+    std::vector<int> elements(sample.begin(), sample.end());
+    for (const int x : elements) {
+        EXPECT_LE(0, x);
+        EXPECT_GT(1000, x);
+    }
+    std::ranges::sort(elements);
+    EXPECT_EQ(elements.end(), std::adjacent_find(elements.begin(), elements.end()));
+    EXPECT_EQ(1000u, queue.size());
+}
+
+TEST(RandomizedQueueRangesTest, random_sample_more_than_size)
+{
+    const auto queue = make_queue(5);
+    std::vector<int> elements;
+    std::ranges::copy(queue | views::random_sample(100), std::back_inserter(elements));
+    std::ranges::sort(elements);
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), elements);
+
+    const queue_t empty;
+    EXPECT_TRUE(std::ranges::empty(empty | views::random_sample(3)));
+}
+
+TEST(RandomizedQueueRangesTest, random_sample_composes)
+{
+    auto queue = make_queue(100);
+    const auto before = allocation_counter::current();
+    int sum = 0;
+    for (const int x : queue | views::random_sample(20) | std::views::transform([](const int x) { return x * 2; }) | std::views::filter([](const int x) { return x % 4 == 0; })) {
+        EXPECT_EQ(0, x % 4);
+        sum += x;
+    }
+    EXPECT_EQ(0u, (allocation_counter::current() - before).count);
+    EXPECT_LE(0, sum);
+}
+
+TEST(RandomizedQueueRangesTest, random_sample_uniform)
+{
+    const std::size_t n = 10;
+    const std::size_t samples = 3333;
+    auto queue = make_queue(static_cast<int>(n));
+    std::vector<std::size_t> counts(n);
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < samples; ++i) {
+        for (const int x : queue | views::random_sample(3)) {
+            ++counts[static_cast<std::size_t>(x)];
+            ++total;
+        }
+    }
+    ASSERT_EQ(3 * samples, total);
+    const double expected = static_cast<double>(total) / static_cast<double>(n);
+    EXPECT_LT(chi_square::statistic(counts, expected), chi_square::limit(n - 1)) << "random_sample(3) over " << n << " elements is skewed";
+}
+
+using IteratorTypesToTest = ::testing::Types<RandomizedQueueRangesIteratorTest<false>,
+      RandomizedQueueRangesIteratorTest<true>, RandomizedQueueRangesBlockedTest>;
+INSTANTIATE_TYPED_TEST_SUITE_P(RandomizedQueueRanges, IteratorTest, IteratorTypesToTest);
+
+#endif
@@ -0,0 +1,252 @@
+#include "randomized_queue.h"
+#include "temp_file.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+struct Point
+{
+    int x;
+    double y;
+    char tag;
+
+    friend bool operator == (const Point & lhs, const Point & rhs)
+    { return lhs.x == rhs.x && lhs.y == rhs.y && lhs.tag == rhs.tag; }
+};
+
+template <class T>
+T create(const int i)
+{
+    return i;
+}
+
+template <>
+Point create<Point>(const int i)
+{
+    return {i, i / 4.0, static_cast<char>('a' + i % 26)};
+}
+
+template <>
+std::string create<std::string>(const int i)
+{
+    // Empty strings, embedded NUL and strings longer than SSO
+    switch (i % 4) {
+    case 0: return {};
+    case 1: return std::string("with\0nul", 8) + std::to_string(i);
+    case 2: return std::string(100 + i % 50, 'x');
+    default: return std::to_string(i);
+    }
+}
+
+template <class T>
+struct RandomizedQueueSnapshotTest : ::testing::Test
+{
+    randomized_queue<T> queue;
+    temp_file file;
+
+    void fill(const int n)
+    {
+        for (int i = 0; i < n; ++i) {
+            queue.enqueue(create<T>(i));
+        }
+    }
+};
+
+using TestedTypes = ::testing::Types<int, Point, std::string>;
+TYPED_TEST_SUITE(RandomizedQueueSnapshotTest, TestedTypes);
+
+// Whole file mapped read-only, unmapped when the test leaves its scope
+class mapped_file
+{
+    const char * m_data = nullptr;
+    std::size_t m_size = 0;
+public:
+    explicit mapped_file(const std::filesystem::path & path)
+        : m_size(std::filesystem::file_size(path))
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open " + path.string());
+        }
+        void * data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("cannot map " + path.string());
+        }
+        m_data = static_cast<const char *>(data);
+    }
+    mapped_file(const mapped_file &) = delete;
+    mapped_file & operator = (const mapped_file &) = delete;
+    ~mapped_file()
+    {
+        ::munmap(const_cast<char *>(m_data), m_size);
+    }
+
+    const char * data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+};
+
+std::uint64_t read_word(const char * p)
+{
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// Elements of a snapshot read in place from the map. Layout: six header words
+// (magic, type tag, size, seed, counter, generation), the length of the random
+// state, the random state, then the elements. Trivially copyable elements are
+// stored as their bytes, strings as a length followed by the characters.
+template <class T>
+auto mapped_elements(const mapped_file & map)
+{
+    constexpr std::size_t word = sizeof(std::uint64_t);
+    const std::uint64_t size = read_word(map.data() + 2 * word);
+    const char * p = map.data() + 7 * word + read_word(map.data() + 6 * word);
+    const char * const end = map.data() + map.size();
+    std::vector<std::conditional_t<std::is_trivially_copyable_v<T>, T, std::string_view>> elements;
+    for (std::uint64_t i = 0; i < size; ++i) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (end - p < static_cast<std::ptrdiff_t>(sizeof(T))) {
+                break;
+            }
+            T x;
+            std::memcpy(&x, p, sizeof(T));
+            elements.push_back(x);
+            p += sizeof(T);
+        }
+        else {
+            if (end - p < static_cast<std::ptrdiff_t>(word)) {
+                break;
+            }
+            const std::uint64_t len = read_word(p);
+            p += word;
+            if (static_cast<std::uint64_t>(end - p) < len) {
+                break;
+            }
+            elements.emplace_back(p, len);
+            p += len;
+        }
+    }
+    EXPECT_EQ(end, p) << "snapshot has bytes past the elements";
+    return elements;
+}
+
+} // anonymous namespace
+
+TYPED_TEST(RandomizedQueueSnapshotTest, empty)
+{
+    this->queue.save(this->file.path());
+    auto restored = randomized_queue<TypeParam>::load(this->file.path());
+    EXPECT_TRUE(restored.empty());
+}
+
+TYPED_TEST(RandomizedQueueSnapshotTest, round_trip)
+{
+    const int n = 10000;
+    this->fill(n);
+    this->queue.dequeue();
+    this->queue.save(this->file.path());
+    auto restored = randomized_queue<TypeParam>::load(this->file.path());
+    EXPECT_EQ(this->queue.size(), restored.size());
+
+    std::vector<TypeParam> saved, loaded;
+    while (!this->queue.empty()) {
+        saved.push_back(this->queue.dequeue());
+    }
+    while (!restored.empty()) {
+        loaded.push_back(restored.dequeue());
+    }
+    // Random state is a part of the snapshot, so both queues go on identically
+    EXPECT_TRUE(saved == loaded);
+}
+
+TYPED_TEST(RandomizedQueueSnapshotTest, continues_stream)
+{
+    this->fill(1000);
+    for (int i = 0; i < 10; ++i) {
+        this->queue.sample();
+    }
+    this->queue.save(this->file.path());
+    auto restored = randomized_queue<TypeParam>::load(this->file.path());
+
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(this->queue.sample() == restored.sample());
+    }
+    const std::vector<TypeParam> v1(this->queue.cbegin(), this->queue.cend());
+    const std::vector<TypeParam> v2(restored.cbegin(), restored.cend());
+    EXPECT_TRUE(v1 == v2);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(this->queue.dequeue() == restored.dequeue());
+    }
+}
+
+TYPED_TEST(RandomizedQueueSnapshotTest, read_through_mmap)
+{
+    const int n = 1000;
+    this->fill(n);
+    this->queue.save(this->file.path());
+    const mapped_file map(this->file.path());
+    const auto mapped = mapped_elements<TypeParam>(map);
+    ASSERT_EQ(this->queue.size(), mapped.size());
+    // Strings are views into the map, nothing is copied out of the file
+    if constexpr (!std::is_trivially_copyable_v<TypeParam>) {
+        for (const auto & x : mapped) {
+            EXPECT_TRUE(x.empty() || (x.data() >= map.data() && x.data() + x.size() <= map.data() + map.size()));
+        }
+    }
+    const std::vector<TypeParam> queued(this->queue.cbegin(), this->queue.cend());
+    const std::vector<TypeParam> read(mapped.begin(), mapped.end());
+    EXPECT_TRUE(std::is_permutation(queued.begin(), queued.end(), read.begin(), read.end()));
+}
+
+TYPED_TEST(RandomizedQueueSnapshotTest, truncated_file)
+{
+    this->fill(1000);
+    this->queue.save(this->file.path());
+    const auto size = std::filesystem::file_size(this->file.path());
+    for (const auto keep : {size - 1, size / 2, std::uintmax_t{4}, std::uintmax_t{0}}) {
+        std::filesystem::resize_file(this->file.path(), keep);
+        EXPECT_THROW(randomized_queue<TypeParam>::load(this->file.path()), std::runtime_error) << keep << " bytes";
+    }
+}
+
+TEST(RandomizedQueueSnapshotErrorsTest, missing_file)
+{
+    EXPECT_THROW(randomized_queue<int>::load("/nonexistent/randomized_queue/snapshot"), std::runtime_error);
+}
+
+TEST(RandomizedQueueSnapshotErrorsTest, not_a_snapshot)
+{
+    const temp_file file("definitely not a randomized_queue snapshot, just some text");
+    EXPECT_THROW(randomized_queue<int>::load(file.path()), std::runtime_error);
+}
+
+TEST(RandomizedQueueSnapshotErrorsTest, wrong_element_type)
+{
+    const temp_file file;
+    randomized_queue<int> queue;
+    for (int i = 0; i < 10; ++i) {
+        queue.enqueue(i);
+    }
+    queue.save(file.path());
+    EXPECT_THROW(randomized_queue<double>::load(file.path()), std::runtime_error);
+    EXPECT_THROW(randomized_queue<std::string>::load(file.path()), std::runtime_error);
+    EXPECT_EQ(10, randomized_queue<int>::load(file.path()).size());
+}
@@ -0,0 +1,120 @@
+#include "allocation_counter.h"
+#include "randomized_queue_soa.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+using soa_queue = randomized_queue_soa<int, double, std::string>;
+
+void fill(soa_queue & queue, const int n)
+{
+    for (int i = 0; i < n; ++i) {
+        queue.enqueue(i, i / 2.0, std::to_string(i));
+    }
+}
+
+} // anonymous namespace
+
+TEST(RandomizedQueueSoaTest, empty)
+{
+    soa_queue queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(0u, queue.size());
+    EXPECT_EQ(queue.end(), queue.begin());
+    EXPECT_EQ(queue.column<1>().end(), queue.column<1>().begin());
+}
+
+TEST(RandomizedQueueSoaTest, fields_stay_together)
+{
+    soa_queue queue;
+    const int n = 1000;
+    fill(queue, n);
+    EXPECT_EQ(static_cast<std::size_t>(n), queue.size());
+
+    for (int i = 0; i < 100; ++i) {
+        const auto [x, half, name] = queue.sample();
+        EXPECT_EQ(x / 2.0, half);
+        EXPECT_EQ(std::to_string(x), name);
+    }
+
+    std::vector<int> order;
+    for (auto it = queue.begin(); it != queue.end(); ++it) {
+        const auto & [x, half, name] = *it;
+        EXPECT_EQ(x, it.get<0>());
+        EXPECT_EQ(x / 2.0, half);
+        EXPECT_EQ(std::to_string(x), name);
+        order.push_back(x);
+    }
+    std::vector<int> expected(n);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_NE(expected, order);
+    std::sort(order.begin(), order.end());
+    EXPECT_EQ(expected, order);
+
+    std::vector<int> dequeued;
+    while (!queue.empty()) {
+        auto [x, half, name] = queue.dequeue();
+        EXPECT_EQ(x / 2.0, half);
+        EXPECT_EQ(std::to_string(x), name);
+        dequeued.push_back(x);
+    }
+    EXPECT_NE(expected, dequeued);
+    std::sort(dequeued.begin(), dequeued.end());
+    EXPECT_EQ(expected, dequeued);
+}
+
+TEST(RandomizedQueueSoaTest, enqueue_tuple)
+{
+    soa_queue queue;
+    queue.enqueue(std::make_tuple(1, 0.5, std::string("One")));
+    EXPECT_EQ(std::make_tuple(1, 0.5, std::string("One")), queue.dequeue());
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(RandomizedQueueSoaTest, column_is_permutation)
+{
+    soa_queue queue;
+    const int n = 1000;
+    fill(queue, n);
+
+    const auto column = queue.column<2>();
+    std::vector<std::string> names(column.begin(), column.end());
+    std::vector<std::string> expected;
+    for (int i = 0; i < n; ++i) {
+        expected.push_back(std::to_string(i));
+    }
+    std::sort(names.begin(), names.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(expected, names);
+}
+
+TEST(RandomizedQueueSoaTest, column_orders_differ)
+{
+    soa_queue queue;
+    fill(queue, 100);
+    const auto c1 = queue.column<0>(), c2 = queue.column<0>();
+    EXPECT_NE(std::vector<int>(c1.begin(), c1.end()), std::vector<int>(c2.begin(), c2.end()));
+}
+
+TEST(RandomizedQueueSoaTest, iteration_does_not_allocate)
+{
+    soa_queue queue;
+    fill(queue, 1000);
+    const auto before = allocation_counter::current();
+    long sum = 0;
+    for (const int x : queue.column<0>()) {
+        sum += x;
+    }
+    for (auto it = queue.begin(); it != queue.end(); ++it) {
+        sum -= it.get<0>();
+    }
+    EXPECT_EQ(0u, (allocation_counter::current() - before).count);
+    EXPECT_EQ(0, sum);
+}
@@ -0,0 +1,120 @@
+#include "allocation_counter.h"
+#include "randomized_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+using counted_queue = randomized_queue<int, std::mt19937, std::allocator<int>, randomized_queue_stats::counting>;
+
+// Custom policy standing in for tracing probes, records hook calls
+struct probe_policy
+{
+    static inline std::size_t dequeues = 0;
+    static inline std::size_t iterators = 0;
+
+    void on_enqueue(std::size_t, std::size_t) const noexcept {}
+    void on_dequeue() const noexcept { ++dequeues; }
+    void on_sample() const noexcept {}
+    void on_iterator(std::size_t) const noexcept { ++iterators; }
+};
+
+} // anonymous namespace
+
+TEST(RandomizedQueueStatsTest, disabled_by_default)
+{
+    static_assert(std::is_empty_v<randomized_queue_stats::none>);
+    static_assert(std::is_same_v<randomized_queue<int>,
+            randomized_queue<int, std::mt19937, std::allocator<int>, randomized_queue_stats::none>>);
+    static_assert(sizeof(randomized_queue<int>) < sizeof(counted_queue));
+}
+
+TEST(RandomizedQueueStatsTest, counts_operations)
+{
+    counted_queue queue;
+    const int n = 1000;
+    for (int i = 0; i < n; ++i) {
+        queue.enqueue(i);
+    }
+    for (int i = 0; i < 10; ++i) {
+        queue.sample();
+    }
+    for (int i = 0; i < 3; ++i) {
+        std::vector<int> order(queue.cbegin(), queue.cend());
+    }
+    for (int i = 0; i < n / 2; ++i) {
+        queue.dequeue();
+    }
+
+    const auto & stats = queue.stats();
+    EXPECT_EQ(static_cast<std::uint64_t>(n), stats.enqueues);
+    EXPECT_EQ(static_cast<std::uint64_t>(n / 2), stats.dequeues);
+    EXPECT_EQ(10u, stats.samples);
+    EXPECT_EQ(3u, stats.iterators);
+    // Iteration order is computed on the fly, no index storage per iterator
+    EXPECT_EQ(0u, stats.permutation_bytes);
+}
+
+TEST(RandomizedQueueStatsTest, reallocations_and_peak)
+{
+    // Only invariants of growth are checked, the growth factor is up to the queue
+    counted_queue queue;
+    const std::size_t n = 10000;
+    std::size_t capacity = 0, max_capacity = 0;
+    std::uint64_t reallocations = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        queue.enqueue(static_cast<int>(i));
+        EXPECT_LE(capacity, queue.capacity());
+        EXPECT_LE(reallocations, queue.stats().reallocations);
+        EXPECT_EQ(reallocations + (capacity != queue.capacity()), queue.stats().reallocations);
+        reallocations = queue.stats().reallocations;
+        capacity = queue.capacity();
+        max_capacity = std::max(max_capacity, capacity);
+    }
+    EXPECT_LE(1u, queue.stats().reallocations);
+    EXPECT_LE(static_cast<std::uint64_t>(n), queue.stats().peak_capacity);
+    EXPECT_EQ(static_cast<std::uint64_t>(max_capacity), queue.stats().peak_capacity);
+
+    while (!queue.empty()) {
+        queue.dequeue();
+    }
+    EXPECT_EQ(static_cast<std::uint64_t>(max_capacity), queue.stats().peak_capacity);
+}
+
+TEST(RandomizedQueueStatsTest, custom_policy_hooks)
+{
+    // The counters are static, reset them for --gtest_repeat
+    probe_policy::dequeues = 0;
+    probe_policy::iterators = 0;
+    randomized_queue<int, std::mt19937, std::allocator<int>, probe_policy> queue;
+    for (int i = 0; i < 10; ++i) {
+        queue.enqueue(i);
+    }
+    const auto it = queue.begin();
+    EXPECT_NE(queue.end(), it);
+    queue.dequeue();
+    queue.dequeue();
+    EXPECT_EQ(2u, probe_policy::dequeues);
+    EXPECT_EQ(1u, probe_policy::iterators);
+}
+
+TEST(RandomizedQueueStatsTest, no_allocations_from_counting)
+{
+    counted_queue queue;
+    for (int i = 0; i < 100; ++i) {
+        queue.enqueue(i);
+    }
+    const auto before = allocation_counter::current();
+    for (int i = 0; i < 100; ++i) {
+        queue.sample();
+        queue.begin();
+    }
+    EXPECT_EQ(0u, (allocation_counter::current() - before).count);
+}
@@ -0,0 +1,166 @@
+#include "allocation_counter.h"
+#include "chi_square.h"
+#include "non_copyable.h"
+#include "small_randomized_queue.h"
+#include "test_iterator.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace {
+
+using test_types::NonCopyable;
+
+constexpr std::size_t inline_capacity = 8;
+
+template <class T>
+struct SmallRandomizedQueueTest : ::testing::Test
+{
+    small_randomized_queue<T, inline_capacity> queue;
+
+    // Initialize sample data for generic iterator tests
+    small_randomized_queue<T, inline_capacity> & not_empty_container()
+    {
+        if (sample.empty()) {
+            for (const int x : {1, 2, 3, 33, 190}) {
+                sample.enqueue(x);
+            }
+        }
+        return sample;
+    }
+
+    T create(const int x)
+    {
+        return x;
+    }
+
+    small_randomized_queue<T, inline_capacity> sample;
+};
+
+using TestedTypes = ::testing::Types<int, NonCopyable>;
+TYPED_TEST_SUITE(SmallRandomizedQueueTest, TestedTypes);
+
+std::vector<int> iota(const std::size_t n)
+{
+    std::vector<int> result(n);
+    std::iota(result.begin(), result.end(), 0);
+    return result;
+}
+
+} // anonymous namespace
+
+TYPED_TEST(SmallRandomizedQueueTest, empty)
+{
+    EXPECT_TRUE(this->queue.empty());
+    EXPECT_EQ(0, this->queue.size());
+    EXPECT_EQ(this->queue.begin(), this->queue.end());
+}
+
+TYPED_TEST(SmallRandomizedQueueTest, no_allocation_within_capacity)
+{
+    std::vector<int> values;
+    values.reserve(inline_capacity);
+    const auto before = allocation_counter::current();
+    {
+        small_randomized_queue<TypeParam, inline_capacity> queue;
+        for (std::size_t i = 0; i < inline_capacity; ++i) {
+            queue.enqueue(this->create(static_cast<int>(i)));
+        }
+        EXPECT_EQ(inline_capacity, queue.size());
+        for (int i = 0; i < 100; ++i) {
+            const int x = queue.sample();
+            EXPECT_LE(0, x);
+            EXPECT_GT(static_cast<int>(inline_capacity), x);
+        }
+        for (const auto & x : queue) {
+            values.push_back(x);
+        }
+        EXPECT_EQ(inline_capacity, values.size());
+        while (!queue.empty()) {
+            queue.dequeue();
+        }
+    }
+    EXPECT_EQ(0, (allocation_counter::current() - before).count);
+}
+
+TYPED_TEST(SmallRandomizedQueueTest, spill_over_capacity)
+{
+    const std::size_t n = 1000;
+    for (std::size_t i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(static_cast<int>(i)));
+    }
+    EXPECT_EQ(n, this->queue.size());
+
+    std::vector<int> order(this->queue.cbegin(), this->queue.cend());
+    std::sort(order.begin(), order.end());
+    EXPECT_EQ(iota(n), order);
+
+    // Drain across the boundary between heap and inline storage and refill
+    std::vector<int> values;
+    for (std::size_t i = 0; i < n - 3; ++i) {
+        values.push_back(this->queue.dequeue());
+    }
+    for (std::size_t i = n; i < n + 10; ++i) {
+        this->queue.enqueue(this->create(static_cast<int>(i)));
+    }
+    while (!this->queue.empty()) {
+        values.push_back(this->queue.dequeue());
+    }
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(iota(n + 10), values);
+}
+
+TYPED_TEST(SmallRandomizedQueueTest, many)
+{
+    for (std::size_t i = 0; i < inline_capacity; ++i) {
+        this->queue.enqueue(this->create(static_cast<int>(i)));
+    }
+    const auto b1 = this->queue.cbegin(), e1 = this->queue.cend();
+    const auto b2 = this->queue.cbegin(), e2 = this->queue.cend();
+    std::vector<int> v11(b1, e1), v12(b1, e1), v21(b2, e2), v22(b2, e2);
+    EXPECT_EQ(v11, v12);
+    EXPECT_EQ(v21, v22);
+    EXPECT_NE(v11, v21);
+    std::sort(v11.begin(), v11.end());
+    EXPECT_EQ(iota(inline_capacity), v11);
+}
+
+TEST(SmallRandomizedQueueSizeTest, fits_two_cache_lines)
+{
+    EXPECT_GE(128, sizeof(small_randomized_queue<int, 8>));
+    EXPECT_GE(128, sizeof(small_randomized_queue<NonCopyable, 8>));
+}
+
+TEST(SmallRandomizedQueueSizeTest, many_queues)
+{
+    // Session-per-queue use: creating lots of small queues must be cheap and
+    // must not give them related random streams
+    const std::size_t count = 10000, n = 5;
+    std::vector<small_randomized_queue<int, 8>> queues(count);
+    const auto before = allocation_counter::current();
+    for (auto & q : queues) {
+        for (std::size_t i = 0; i < n; ++i) {
+            q.enqueue(static_cast<int>(i));
+        }
+    }
+    EXPECT_EQ(0, (allocation_counter::current() - before).count);
+
+    // Pairs of first elements from neighbouring queues, independent queues
+    // spread them evenly over all n * n cells
+    std::vector<std::size_t> pairs(n * n);
+    for (std::size_t i = 0; i + 1 < count; i += 2) {
+        const auto a = static_cast<std::size_t>(queues[i].dequeue());
+        const auto b = static_cast<std::size_t>(queues[i + 1].dequeue());
+        ++pairs[a * n + b];
+    }
+    const double expected = static_cast<double>(count / 2) / static_cast<double>(n * n);
+    EXPECT_LT(chi_square::statistic(pairs, expected), chi_square::limit(n * n - 1))
+            << "first elements of neighbouring queues are correlated";
+}
+
+using TypesToTest = ::testing::Types<SmallRandomizedQueueTest<int>>;
+INSTANTIATE_TYPED_TEST_SUITE_P(SmallRandomizedQueue, IteratorTest, TypesToTest);
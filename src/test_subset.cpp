@@ -1,10 +1,109 @@
+#include "allocation_counter.h"
+#include "chi_square.h"
 #include "subset.h"
+#include "temp_file.h"
 
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <set>
 #include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> split_lines(const std::string & text)
+{
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+std::string numbered_lines(const std::size_t n)
+{
+    std::string result;
+    for (std::size_t i = 0; i < n; ++i) {
+        result += "line " + std::to_string(i) + '\n';
+    }
+    return result;
+}
+
+std::string read_all(std::FILE * file)
+{
+    std::fflush(file);
+    std::rewind(file);
+    std::string result;
+    char buffer[4096];
+    std::size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        result.append(buffer, read);
+    }
+    return result;
+}
+
+// Anonymous temporary file for subset() output, a failure to create it is reported
+unique_file temp_output()
+{
+    unique_file out(std::tmpfile());
+    EXPECT_TRUE(out) << "std::tmpfile() failed: " << std::strerror(errno);
+    return out;
+}
+
+// Runs the file based subset() and returns everything written to the output
+std::string subset_file(const unsigned long k, const temp_file & input)
+{
+    const auto out = temp_output();
+    if (!out) {
+        return {};
+    }
+    subset(k, input.path(), out.get());
+    return read_all(out.get());
+}
+
+// Runs the multi-file subset() over the given shards, threads = 0 lets
+// subset() use std::thread::hardware_concurrency() workers
+std::string subset_files(const unsigned long k, const std::vector<std::unique_ptr<temp_file>> & inputs, const unsigned threads)
+{
+    std::vector<std::filesystem::path> paths;
+    for (const auto & input : inputs) {
+        paths.push_back(input->path());
+    }
+    const auto out = temp_output();
+    if (!out) {
+        return {};
+    }
+    subset(k, paths, out.get(), threads);
+    return read_all(out.get());
+}
+
+// Shards of the given sizes, lines are numbered through all of them
+std::vector<std::unique_ptr<temp_file>> shards(const std::vector<std::size_t> & sizes)
+{
+    std::vector<std::unique_ptr<temp_file>> result;
+    std::size_t line = 0;
+    for (const auto size : sizes) {
+        std::string text;
+        for (std::size_t i = 0; i < size; ++i, ++line) {
+            text += "line " + std::to_string(line) + '\n';
+        }
+        result.push_back(std::make_unique<temp_file>(text));
+    }
+    return result;
+}
+
+} // anonymous namespace
 
 TEST(SubsetTest, zero_from_empty)
 {
@@ -52,3 +151,260 @@ TEST(SubsetTest, three_from_three)
     EXPECT_LE(2, line_count);
     EXPECT_GE(3, line_count);
 }
+
+TEST(SubsetTest, all_from_three)
+{
+    std::stringstream input, output;
+    input << "One\nTwo\nThree\n";
+    subset(10, input, output);
+    auto lines = split_lines(output.str());
+    std::sort(lines.begin(), lines.end());
+    EXPECT_EQ((std::vector<std::string>{"One", "Three", "Two"}), lines);
+}
+
+TEST(SubsetTest, three_from_many)
+{
+    const std::size_t n = 1000;
+    std::stringstream input, output;
+    input << numbered_lines(n);
+    subset(3, input, output);
+    const auto lines = split_lines(output.str());
+    ASSERT_EQ(3, lines.size());
+    EXPECT_EQ(3, std::set<std::string>(lines.begin(), lines.end()).size());
+    for (const auto & line : lines) {
+        EXPECT_EQ(0, line.rfind("line ", 0)) << line;
+        EXPECT_GT(n, std::stoul(line.substr(5)));
+    }
+}
+
+TEST(SubsetTest, uniform_selection)
+{
+    // Every line must have the same chance k / n to be selected,
+    // wherever it is placed in the input
+    const std::size_t n = 10, k = 3, runs = 10000;
+    const auto text = numbered_lines(n);
+    std::vector<std::size_t> counts(n);
+    for (std::size_t r = 0; r < runs; ++r) {
+        std::stringstream input, output;
+        input << text;
+        subset(k, input, output);
+        const auto lines = split_lines(output.str());
+        ASSERT_EQ(k, lines.size());
+        for (const auto & line : lines) {
+            ++counts[std::stoul(line.substr(5))];
+        }
+    }
+    const double expected = static_cast<double>(runs * k) / n;
+    EXPECT_LT(chi_square::statistic(counts, expected), chi_square::limit(n - 1));
+}
+
+TEST(SubsetTest, memory_independent_of_input_size)
+{
+    // Only k lines may be resident while a large input is streamed
+    std::stringstream input, output;
+    input << numbered_lines(200000);
+    allocation_counter::reset_peak();
+    const auto baseline = allocation_counter::live_bytes();
+    subset(3, input, output);
+    EXPECT_EQ(3, split_lines(output.str()).size());
+    EXPECT_GT(64 * 1024, allocation_counter::peak_bytes() - baseline);
+}
+
+TEST(SubsetTest, lines_allocated_in_bulk)
+{
+    // Selected lines have to be kept in a few large blocks, not one heap
+    // allocation per line
+    const std::size_t n = 100000;
+    std::stringstream input, output;
+    for (std::size_t i = 0; i < n; ++i) {
+        input << "a line which does not fit into SSO buffer #" << i << '\n';
+    }
+    const auto before = allocation_counter::current();
+    subset(n, input, output);
+    const auto allocated = allocation_counter::current() - before;
+    EXPECT_EQ(n, split_lines(output.str()).size());
+    EXPECT_GT(n / 100, allocated.count);
+}
+
+TEST(SubsetFileTest, zero_from_one)
+{
+    const temp_file input("One\n");
+    EXPECT_TRUE(subset_file(0, input).empty());
+}
+
+TEST(SubsetFileTest, three_from_empty)
+{
+    const temp_file input("");
+    EXPECT_TRUE(subset_file(3, input).empty());
+}
+
+TEST(SubsetFileTest, three_from_three)
+{
+    // Last line has no trailing newline, it is still a line
+    const temp_file input("One\nTwo\nThree");
+    const auto out = subset_file(3, input);
+    EXPECT_EQ(3, std::count(out.begin(), out.end(), '\n'));
+    auto lines = split_lines(out);
+    std::sort(lines.begin(), lines.end());
+    EXPECT_EQ((std::vector<std::string>{"One", "Three", "Two"}), lines);
+}
+
+TEST(SubsetFileTest, three_from_many)
+{
+    const temp_file input(numbered_lines(1000));
+    const auto lines = split_lines(subset_file(3, input));
+    ASSERT_EQ(3, lines.size());
+    EXPECT_EQ(3, std::set<std::string>(lines.begin(), lines.end()).size());
+    for (const auto & line : lines) {
+        EXPECT_EQ(0, line.rfind("line ", 0)) << line;
+    }
+}
+
+TEST(SubsetFileTest, same_as_stream)
+{
+    const auto text = numbered_lines(5000);
+    const temp_file input(text);
+    auto from_file = split_lines(subset_file(5000, input));
+    std::stringstream in, out;
+    in << text;
+    subset(5000, in, out);
+    auto from_stream = split_lines(out.str());
+    EXPECT_NE(from_file, from_stream);
+    std::sort(from_file.begin(), from_file.end());
+    std::sort(from_stream.begin(), from_stream.end());
+    EXPECT_EQ(from_stream, from_file);
+}
+
+TEST(SubsetFileTest, uniform_selection)
+{
+    const std::size_t n = 10, k = 3, runs = 3000;
+    const temp_file input(numbered_lines(n));
+    std::vector<std::size_t> counts(n);
+    for (std::size_t r = 0; r < runs; ++r) {
+        const auto lines = split_lines(subset_file(k, input));
+        ASSERT_EQ(k, lines.size());
+        for (const auto & line : lines) {
+            ++counts[std::stoul(line.substr(5))];
+        }
+    }
+    const double expected = static_cast<double>(runs * k) / n;
+    EXPECT_LT(chi_square::statistic(counts, expected), chi_square::limit(n - 1));
+}
+
+TEST(SubsetFileTest, lines_are_not_copied)
+{
+    // Lines are too long for the small string optimization, so a reader
+    // which copies each line into a std::string allocates per line
+    const std::size_t n = 100000;
+    std::string text;
+    for (std::size_t i = 0; i < n; ++i) {
+        text += "a line which does not fit into SSO buffer #" + std::to_string(i) + '\n';
+    }
+    const temp_file input(text);
+    const auto before = allocation_counter::current();
+    const auto out = subset_file(n, input);
+    const auto allocated = allocation_counter::current() - before;
+    EXPECT_EQ(n, static_cast<std::size_t>(std::count(out.begin(), out.end(), '\n')));
+    EXPECT_GT(n / 100, allocated.count);
+}
+
+TEST(SubsetFileTest, line_boundaries)
+{
+    // Line lengths 0..130 put newlines at every offset of 16, 32 and 64 byte
+    // blocks, so a vectorized scanner has to handle all of its tail cases
+    for (const bool trailing_newline : {true, false}) {
+        std::string text;
+        std::vector<std::string> expected;
+        for (std::size_t len = 0; len <= 130; ++len) {
+            std::string line(len, static_cast<char>('a' + len % 26));
+            if (len > 2) {
+                line[len / 2] = '\r';
+                line[len / 3] = '\0';
+            }
+            text += line;
+            text += '\n';
+            expected.push_back(line);
+        }
+        if (!trailing_newline) {
+            text += "unterminated";
+            expected.push_back("unterminated");
+        }
+        const temp_file input(text);
+        auto lines = split_lines(subset_file(expected.size() + 1, input));
+        std::sort(lines.begin(), lines.end());
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(expected, lines);
+    }
+}
+
+TEST(SubsetFileTest, only_newlines)
+{
+    const temp_file input(std::string(100, '\n'));
+    const auto out = subset_file(1000, input);
+    EXPECT_EQ(std::string(100, '\n'), out);
+}
+
+TEST(SubsetFileTest, missing_file)
+{
+    const auto out = temp_output();
+    ASSERT_TRUE(out);
+    EXPECT_THROW(subset(3, std::filesystem::path("/nonexistent/subset/input"), out.get()), std::system_error);
+}
+
+TEST(SubsetShardsTest, no_inputs)
+{
+    EXPECT_TRUE(subset_files(3, {}, 4).empty());
+}
+
+TEST(SubsetShardsTest, all_lines_once)
+{
+    const auto inputs = shards({0, 1, 100, 7, 1000, 0, 33});
+    for (const unsigned threads : {1u, 2u, 4u, 16u}) {
+        auto lines = split_lines(subset_files(10000, inputs, threads));
+        ASSERT_EQ(1141, lines.size());
+        std::vector<std::size_t> numbers;
+        for (const auto & line : lines) {
+            numbers.push_back(std::stoul(line.substr(5)));
+        }
+        std::sort(numbers.begin(), numbers.end());
+        for (std::size_t i = 0; i < numbers.size(); ++i) {
+            ASSERT_EQ(i, numbers[i]);
+        }
+    }
+}
+
+TEST(SubsetShardsTest, three_from_many)
+{
+    const auto inputs = shards({500, 500, 500, 500});
+    // Default thread count
+    const auto lines = split_lines(subset_files(3, inputs, 0));
+    ASSERT_EQ(3, lines.size());
+    EXPECT_EQ(3, std::set<std::string>(lines.begin(), lines.end()).size());
+}
+
+TEST(SubsetShardsTest, uniform_over_unequal_shards)
+{
+    // Merging per-thread reservoirs has to weight them by the number of lines
+    // each one has seen, otherwise the single line shard is overrepresented
+    const std::size_t n = 12, k = 2, runs = 3000;
+    const auto inputs = shards({1, 2, 9});
+    std::vector<std::size_t> counts(n);
+    for (std::size_t r = 0; r < runs; ++r) {
+        const auto lines = split_lines(subset_files(k, inputs, 3));
+        ASSERT_EQ(k, lines.size());
+        for (const auto & line : lines) {
+            ++counts[std::stoul(line.substr(5))];
+        }
+    }
+    const double expected = static_cast<double>(runs * k) / n;
+    EXPECT_LT(chi_square::statistic(counts, expected), chi_square::limit(n - 1));
+}
+
+TEST(SubsetShardsTest, missing_shard)
+{
+    auto inputs = shards({10, 10});
+    std::vector<std::filesystem::path> paths = {inputs[0]->path(), "/nonexistent/subset/shard", inputs[1]->path()};
+    const auto out = temp_output();
+    ASSERT_TRUE(out);
+    EXPECT_THROW(subset(3, paths, out.get(), 2), std::system_error);
+}
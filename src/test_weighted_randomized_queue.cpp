@@ -0,0 +1,163 @@
+#include "chi_square.h"
+#include "non_copyable.h"
+#include "weighted_randomized_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+using test_types::NonCopyable;
+
+template <class T>
+struct WeightedRandomizedQueueTest : ::testing::Test
+{
+    weighted_randomized_queue<T> queue;
+
+    T create(const int x)
+    {
+        return x;
+    }
+};
+
+using TestedTypes = ::testing::Types<int, NonCopyable>;
+TYPED_TEST_SUITE(WeightedRandomizedQueueTest, TestedTypes);
+
+// Chi-square statistic against counts proportional to the weights
+double weighted_chi_square(const std::vector<std::size_t> & counts, const std::vector<double> & weights)
+{
+    const double total_count = static_cast<double>(std::accumulate(counts.begin(), counts.end(), std::size_t{0}));
+    const double total_weight = std::accumulate(weights.begin(), weights.end(), 0.0);
+    double sum = 0;
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        const double expected = total_count * weights[i] / total_weight;
+        const double d = static_cast<double>(counts[i]) - expected;
+        sum += d * d / expected;
+    }
+    return sum;
+}
+
+} // anonymous namespace
+
+TYPED_TEST(WeightedRandomizedQueueTest, empty)
+{
+    EXPECT_TRUE(this->queue.empty());
+    EXPECT_EQ(0, this->queue.size());
+}
+
+TYPED_TEST(WeightedRandomizedQueueTest, singleton)
+{
+    this->queue.enqueue(this->create(7), 0.5);
+    EXPECT_FALSE(this->queue.empty());
+    EXPECT_EQ(1, this->queue.size());
+    EXPECT_EQ(7, this->queue.sample());
+    this->queue.freeze();
+    EXPECT_EQ(7, this->queue.sample());
+    EXPECT_EQ(7, this->queue.dequeue());
+    EXPECT_TRUE(this->queue.empty());
+}
+
+TYPED_TEST(WeightedRandomizedQueueTest, dequeue_everything)
+{
+    const int n = 1000;
+    for (int i = 0; i < n; ++i) {
+        this->queue.enqueue(this->create(i), 1.0 + i % 7);
+    }
+    EXPECT_EQ(n, this->queue.size());
+    std::vector<int> values;
+    while (!this->queue.empty()) {
+        values.push_back(this->queue.dequeue());
+    }
+    std::sort(values.begin(), values.end());
+    std::vector<int> expected(n);
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(expected, values);
+}
+
+TYPED_TEST(WeightedRandomizedQueueTest, sample_proportional_to_weight)
+{
+    const std::vector<double> weights = {1, 2, 3, 4, 10, 0.5};
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        this->queue.enqueue(this->create(static_cast<int>(i)), weights[i]);
+    }
+    const std::size_t samples = 100000;
+    for (const bool frozen : {false, true}) {
+        if (frozen) {
+            this->queue.freeze();
+            EXPECT_TRUE(this->queue.frozen());
+        }
+        std::vector<std::size_t> counts(weights.size());
+        for (std::size_t i = 0; i < samples; ++i) {
+            ++counts[static_cast<std::size_t>(static_cast<int>(this->queue.sample()))];
+        }
+        EXPECT_LT(weighted_chi_square(counts, weights), chi_square::limit(weights.size() - 1))
+            << (frozen ? "alias table" : "sum tree") << " sampling is skewed";
+    }
+}
+
+TYPED_TEST(WeightedRandomizedQueueTest, dequeue_proportional_to_weight)
+{
+    const std::vector<double> weights = {1, 5, 2, 8};
+    std::vector<std::size_t> first(weights.size());
+    for (std::size_t r = 0; r < 20000; ++r) {
+        weighted_randomized_queue<TypeParam> queue;
+        for (std::size_t i = 0; i < weights.size(); ++i) {
+            queue.enqueue(this->create(static_cast<int>(i)), weights[i]);
+        }
+        ++first[static_cast<std::size_t>(static_cast<int>(queue.dequeue()))];
+    }
+    EXPECT_LT(weighted_chi_square(first, weights), chi_square::limit(weights.size() - 1));
+}
+
+TYPED_TEST(WeightedRandomizedQueueTest, weights_follow_elements)
+{
+    // After removals the remaining elements must keep their own weights,
+    // not the weights of the slots they were moved into
+    std::vector<double> weights;
+    for (int i = 0; i < 100; ++i) {
+        weights.push_back(1.0 + i);
+        this->queue.enqueue(this->create(i), weights.back());
+    }
+    std::vector<bool> removed(weights.size());
+    for (int i = 0; i < 50; ++i) {
+        removed[static_cast<std::size_t>(static_cast<int>(this->queue.dequeue()))] = true;
+    }
+    std::vector<double> remaining_weights;
+    std::vector<std::size_t> index(weights.size());
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        if (!removed[i]) {
+            index[i] = remaining_weights.size();
+            remaining_weights.push_back(weights[i]);
+        }
+    }
+    std::vector<std::size_t> counts(remaining_weights.size());
+    for (std::size_t i = 0; i < 200000; ++i) {
+        const auto x = static_cast<std::size_t>(static_cast<int>(this->queue.sample()));
+        ASSERT_FALSE(removed[x]);
+        ++counts[index[x]];
+    }
+    EXPECT_LT(weighted_chi_square(counts, remaining_weights), chi_square::limit(counts.size() - 1));
+}
+
+TYPED_TEST(WeightedRandomizedQueueTest, modify_after_freeze)
+{
+    this->queue.enqueue(this->create(0), 1);
+    this->queue.enqueue(this->create(1), 1);
+    this->queue.freeze();
+    this->queue.enqueue(this->create(2), 1000);
+    EXPECT_FALSE(this->queue.frozen());
+    std::size_t heavy = 0;
+    for (int i = 0; i < 1000; ++i) {
+        heavy += this->queue.sample() == 2;
+    }
+    EXPECT_LT(900, heavy);
+
+    this->queue.freeze();
+    EXPECT_EQ(3, this->queue.size());
+    this->queue.dequeue();
+    EXPECT_FALSE(this->queue.frozen());
+    EXPECT_EQ(2, this->queue.size());
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running submitted tasks, wait() blocks until all
+// of them have finished
+class thread_pool
+{
+public:
+    explicit thread_pool(const std::size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (std::size_t i = 0; i < threads; ++i) {
+            m_workers.emplace_back([this] { work(); });
+        }
+    }
+
+    thread_pool(const thread_pool &) = delete;
+    thread_pool & operator = (const thread_pool &) = delete;
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_task_ready.notify_all();
+        for (auto & t : m_workers) {
+            t.join();
+        }
+    }
+
+    std::size_t size() const { return m_workers.size(); }
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+            ++m_pending;
+        }
+        m_task_ready.notify_one();
+    }
+
+    void wait()
+    {
+        std::unique_lock lock(m_mutex);
+        m_all_done.wait(lock, [this] { return m_pending == 0; });
+    }
+
+private:
+    void work()
+    {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(m_mutex);
+                m_task_ready.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+                if (m_tasks.empty()) {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+            std::lock_guard lock(m_mutex);
+            if (--m_pending == 0) {
+                m_all_done.notify_all();
+            }
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_task_ready;
+    std::condition_variable m_all_done;
+    std::deque<std::function<void()>> m_tasks;
+    std::size_t m_pending = 0;
+    bool m_stop = false;
+    std::vector<std::thread> m_workers;
+};